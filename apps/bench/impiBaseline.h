@@ -0,0 +1,205 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    // ==================================================================== //
+    // Timings of an earlier run, read back from a report written with
+    // -report (JSON or CSV). Nested keys are flattened with dots, e.g.
+    // "phases.modelCommit" or "frames.measured.p50". Only numbers are
+    // kept, strings and arrays are skipped.
+    // ==================================================================== //
+    class Baseline {
+    public:
+      struct Diff {
+        std::string key;
+        double baseline;
+        double current;
+        bool regression;
+      };
+
+      std::map<std::string, double> values;
+
+      void Load(const std::string& fileName)
+      {
+        std::ifstream is(fileName);
+        if (!is) {
+          throw std::runtime_error("cannot open baseline " + fileName);
+        }
+        std::stringstream ss;
+        ss << is.rdbuf();
+        const std::string text = ss.str();
+        const auto dot = fileName.find_last_of('.');
+        if (dot != std::string::npos && fileName.substr(dot) == ".csv") {
+          ParseCSV(text);
+        } else {
+          size_t p = 0;
+          ParseValue(text, p, "");
+        }
+        if (values.empty()) {
+          throw std::runtime_error("no values in baseline " + fileName);
+        }
+      }
+
+      //! a timing regressed if it got slower by more than 'tolerance'
+      //! (relative) and by more than 'minSeconds' (absolute, to ignore
+      //! noise of very short phases). timings without a baseline are
+      //! listed as new but never regressions
+      std::vector<Diff> Compare(
+        const std::vector<std::pair<std::string, double>>& current,
+        const double tolerance, const double minSeconds) const
+      {
+        std::vector<Diff> diffs;
+        for (const auto& c : current) {
+          const auto b = values.find(c.first);
+          if (b == values.end()) {
+            diffs.push_back({c.first, NAN, c.second, false});
+            continue;
+          }
+          const bool slower = c.second > b->second * (1.0 + tolerance) &&
+            c.second - b->second > minSeconds;
+          diffs.push_back({c.first, b->second, c.second, slower});
+        }
+        return diffs;
+      }
+
+      //! print the comparison as a table, returns the number of regressions
+      static int Print(const std::vector<Diff>& diffs)
+      {
+        int regressions = 0;
+        std::cout << std::left << std::setw(32) << "#osp:bench: metric"
+                  << std::right << std::setw(12) << "baseline"
+                  << std::setw(12) << "current" << std::setw(10) << "change"
+                  << std::endl;
+        for (const auto& d : diffs) {
+          std::cout << std::left << std::setw(32) << ("#osp:bench: " + d.key)
+                    << std::right << std::setprecision(4);
+          if (std::isnan(d.baseline)) {
+            std::cout << std::setw(12) << "-" << std::setw(12) << d.current
+                      << std::setw(10) << "new" << std::endl;
+            continue;
+          }
+          std::ostringstream change;
+          if (d.baseline > 0.0) {
+            change << std::showpos << std::fixed << std::setprecision(1)
+                   << 100.0 * (d.current - d.baseline) / d.baseline << "%";
+          } else {
+            change << "-";
+          }
+          std::cout << std::setw(12) << d.baseline << std::setw(12)
+                    << d.current << std::setw(10) << change.str()
+                    << (d.regression ? "  REGRESSION" : "") << std::endl;
+          if (d.regression) ++regressions;
+        }
+        return regressions;
+      }
+
+    private:
+      static void SkipSpace(const std::string& s, size_t& p)
+      {
+        while (p < s.size() && std::isspace((unsigned char)s[p])) ++p;
+      }
+      static void Expect(const std::string& s, size_t& p, const char c)
+      {
+        SkipSpace(s, p);
+        if (p >= s.size() || s[p] != c) {
+          throw std::runtime_error(std::string("baseline: expected '") + c +
+                                   "' at offset " + std::to_string(p));
+        }
+        ++p;
+      }
+      static std::string ParseString(const std::string& s, size_t& p)
+      {
+        Expect(s, p, '"');
+        std::string r;
+        while (p < s.size() && s[p] != '"') {
+          if (s[p] == '\\' && p + 1 < s.size()) ++p;
+          r += s[p++];
+        }
+        Expect(s, p, '"');
+        return r;
+      }
+      void ParseValue(const std::string& s, size_t& p, const std::string& key)
+      {
+        SkipSpace(s, p);
+        if (p >= s.size()) {
+          throw std::runtime_error("baseline: unexpected end of file");
+        }
+        const char c = s[p];
+        if (c == '{') {
+          ++p;
+          SkipSpace(s, p);
+          if (p < s.size() && s[p] == '}') { ++p; return; }
+          do {
+            const std::string k = ParseString(s, p);
+            Expect(s, p, ':');
+            ParseValue(s, p, key.empty() ? k : key + "." + k);
+            SkipSpace(s, p);
+          } while (p < s.size() && s[p] == ',' && ++p);
+          Expect(s, p, '}');
+        } else if (c == '[') {
+          ++p;
+          SkipSpace(s, p);
+          if (p < s.size() && s[p] == ']') { ++p; return; }
+          do {
+            ParseValue(s, p, ""); // array elements are not kept
+            SkipSpace(s, p);
+          } while (p < s.size() && s[p] == ',' && ++p);
+          Expect(s, p, ']');
+        } else if (c == '"') {
+          ParseString(s, p);
+        } else {
+          const size_t start = p;
+          while (p < s.size() && (std::isalnum((unsigned char)s[p]) ||
+                                  s[p] == '-' || s[p] == '+' || s[p] == '.')) {
+            ++p;
+          }
+          const std::string literal = s.substr(start, p - start);
+          if (literal.empty()) {
+            throw std::runtime_error("baseline: unexpected '" +
+                                     std::string(1, c) + "' at offset " +
+                                     std::to_string(start));
+          }
+          char* end = nullptr;
+          const double v = std::strtod(literal.c_str(), &end);
+          if (!key.empty() && *end == '\0') values[key] = v;
+        }
+      }
+      void ParseCSV(const std::string& text)
+      {
+        std::istringstream is(text);
+        std::string line;
+        std::getline(is, line); // header
+        while (std::getline(is, line)) {
+          const auto a = line.find(',');
+          const auto b = line.find(',', a + 1);
+          if (a == std::string::npos || b == std::string::npos) continue;
+          const std::string value = line.substr(b + 1);
+          char* end = nullptr;
+          const double v = std::strtod(value.c_str(), &end);
+          if (!value.empty() && *end == '\0') {
+            values[line.substr(0, a) + "." + line.substr(a + 1, b - a - 1)] = v;
+          }
+        }
+      }
+    };
+
+  };
+};
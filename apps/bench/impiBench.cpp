@@ -21,7 +21,19 @@
 
 #include "impiHelper.h"
 #include "impiReader.h"
+#include "impiModule.h"
+#include "impiReport.h"
+#include "impiBaseline.h"
+#include "impiCameraPath.h"
+#include "impiImage.h"
+#include "impiJobs.h"
+#include "impiTimeSeries.h"
 #include "loader/meshloader.h"
+#include "ospcommon/tasking/parallel_for.h"
+
+#include <future>
+#include <mutex>
+#include <set>
 
 #ifdef __unix__
 # include <unistd.h>
@@ -31,6 +43,10 @@
 #include "opengl/viewer.h"
 #endif
 
+#if IMPI_MPI
+# include <mpi.h>
+#endif
+
 using namespace ospcommon;
 
 static bool showVolume{false};
@@ -38,6 +54,62 @@ static bool showObject{false};
 static enum {IMPI, NORMAL} isoMode;
 static std::string rendererName = "scivis";
 static std::string outputImageName = "result";
+static std::string reportName; // empty: no report
+static std::string cameraPathName;
+static bool cameraOrbit{false};
+static bool dumpFrames{false};
+static vec2f isoSweepRange{0.f, 0.f};
+static int isoSweepSteps{0}; // 0: no sweep
+static int scalingThreads{0}; // 0: no thread scaling run
+static bool abCompare{false};
+static std::string abReference; // empty: no reference image
+static float abMinPSNR{0.f};    // 0: do not fail on image differences
+static std::string baselineName; // empty: no regression check
+static float baselineTolerance{0.1f}; // relative slowdown that fails
+static float baselineMinSeconds{0.005f}; // smaller slowdowns are noise
+static std::string jobsName; // empty: no batch of jobs
+static bool eyelight{false};
+static std::vector<vec2i> fbSweep; // empty: no resolution sweep
+static std::vector<int> sppSweep;  // empty: no spp sweep
+// data-parallel: every rank runs the bench on the mpi_distributed
+// device, loads its region of the volume and renders it, ospray
+// composites the regions. only rank 0 writes images and the report
+static bool dataParallel{false};
+static int mpiRank{0};
+static int mpiSize{1};
+// time series: the frames rendered per timestep, and whether the next
+// timestep is loaded and extracted while the current one renders
+static int stepFrames{1};
+static bool prefetchSteps{true};
+static bool temporalReuse{false};
+// the Chombo component that colours the impi surfaces (empty: isoColor)
+static std::string attributeName;
+
+// peak resident memory of each phase, in bytes
+static std::vector<std::pair<std::string, size_t>> phaseMemory;
+static void MemoryPhase(const std::string& name) {
+  phaseMemory.emplace_back(name, ospray::impi::PeakResidentMemory());
+  ospray::impi::ResetPeakResidentMemory();
+}
+
+// the threads ospray's tasking system actually runs on: the distinct
+// threads that pick up tasks which each keep a thread busy for a while
+static int ActiveThreads() {
+  const int numTasks = 4 * std::max(1u, std::thread::hardware_concurrency());
+  std::mutex lock;
+  std::set<std::thread::id> threads;
+  ospcommon::tasking::parallel_for(numTasks, [&](int) {
+    const auto t0 = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - t0 < 
+	   std::chrono::milliseconds(2)) {}
+    std::lock_guard<std::mutex> l(lock);
+    threads.insert(std::this_thread::get_id());
+  });
+  return (int)threads.size();
+}
+// the thread count ospray was started with (--osp:numthreads or
+// OSPRAY_THREADS), -1 for all
+static int launchThreads{-1};
 
 struct ISO {
   float v = 0.0f;
@@ -627,7 +699,33 @@ int main(int ac, const char** av)
   gethostname(hname, 200);
   std::cout << "#osp: on host >> " << hname << " <<" << std::endl;;
 #endif
-  if (ospInit(&ac, av) != OSP_NO_ERROR) {
+  // the distributed device has to exist before anything else
+  for (int i = 1; i < ac; ++i) {
+    if (std::string(av[i]) == "-data-parallel") dataParallel = true;
+  }
+  // ospInit consumes --osp:numthreads, the thread scaling restores it
+  if (const char* nt = getenv("OSPRAY_THREADS")) launchThreads = atoi(nt);
+  for (int i = 1; i + 1 < ac; ++i) {
+    if (std::string(av[i]) == "--osp:numthreads") launchThreads = atoi(av[i + 1]);
+  }
+  if (dataParallel) {
+#if IMPI_MPI
+    if (ospLoadModule("mpi") != OSP_NO_ERROR) {
+      throw std::runtime_error("-data-parallel needs ospray's mpi module");
+    }
+    OSPDevice mpiDevice = ospNewDevice("mpi_distributed");
+    ospDeviceSet1i(mpiDevice, "masterRank", 0);
+    ospDeviceCommit(mpiDevice);
+    ospSetCurrentDevice(mpiDevice);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+    std::cout << "#osp:bench: data-parallel rank " << mpiRank << "/"
+	      << mpiSize << std::endl;
+#else
+    throw std::runtime_error("-data-parallel: built without mpi");
+#endif
+  }
+  else if (ospInit(&ac, av) != OSP_NO_ERROR) {
     throw std::runtime_error("FATAL ERROR DURING INITIALIZATION!");
     return 1;
   }
@@ -647,6 +745,108 @@ int main(int ac, const char** av)
     if (str == "-o") {
       outputImageName = av[++i];
     }
+    else if (str == "-report") {
+      reportName = av[++i];
+    }
+    else if (str == "-camera-path") {
+      cameraPathName = av[++i];
+    }
+    else if (str == "-camera-orbit") {
+      cameraOrbit = true;
+    }
+    else if (str == "-dump-frames") {
+      dumpFrames = true;
+    }
+    else if (str == "-iso-sweep") {
+      try {
+	ospray::impi::Parse<2>(ac, av, i, isoSweepRange);
+	ospray::impi::Parse<1>(ac, av, i, isoSweepSteps);
+      } catch (const std::runtime_error& e) {
+	throw std::runtime_error(std::string(e.what())+
+				 " usage: -iso-sweep "
+				 "<min iso-value> <max iso-value> "
+				 "<# of steps>");
+      }
+    }
+    else if (str == "-thread-scaling") {
+      // optional maximum thread count, defaults to all hardware threads
+      scalingThreads = std::thread::hardware_concurrency();
+      if (i + 1 < ac && av[i + 1][0] != '-') {
+	ospray::impi::Parse<1>(ac, av, i, scalingThreads);
+      }
+    }
+    else if (str == "-ab-compare") {
+      // optional reference image to compare both results against
+      abCompare = true;
+      if (i + 1 < ac && av[i + 1][0] != '-') {
+	abReference = av[++i];
+      }
+    }
+    else if (str == "-ab-min-psnr") {
+      ospray::impi::Parse<1>(ac, av, i, abMinPSNR);
+    }
+    else if (str == "-baseline") {
+      baselineName = av[++i];
+    }
+    else if (str == "-baseline-tolerance") {
+      ospray::impi::Parse<1>(ac, av, i, baselineTolerance);
+    }
+    else if (str == "-baseline-min") {
+      ospray::impi::Parse<1>(ac, av, i, baselineMinSeconds);
+    }
+    else if (str == "-fb-sweep") {
+      // optional list of sizes, e.g. 512x512,1920x1080
+      std::string list = "512x512,1024x1024,1920x1080,2560x1440,3840x2160";
+      if (i + 1 < ac && av[i + 1][0] != '-') list = av[++i];
+      std::istringstream ls(list);
+      std::string size;
+      while (std::getline(ls, size, ',')) {
+	vec2i v;
+	char x = 0;
+	std::istringstream ss(size);
+	if (!(ss >> v.x >> x >> v.y) || x != 'x' || v.x <= 0 || v.y <= 0) {
+	  throw std::runtime_error("bad size '" + size + "' usage: -fb-sweep "
+				   "[<width>x<height>,...]");
+	}
+	fbSweep.push_back(v);
+      }
+    }
+    else if (str == "-spp-sweep") {
+      // optional list of samples per pixel, e.g. 1,2,4
+      std::string list = "1,2,4,8,16";
+      if (i + 1 < ac && av[i + 1][0] != '-') list = av[++i];
+      std::istringstream ls(list);
+      std::string spp;
+      while (std::getline(ls, spp, ',')) {
+	const int n = atoi(spp.c_str());
+	if (n < 1) {
+	  throw std::runtime_error("bad spp '" + spp + "' usage: -spp-sweep "
+				   "[<spp>,...]");
+	}
+	sppSweep.push_back(n);
+      }
+    }
+    else if (str == "-eyelight") {
+      eyelight = true;
+    }
+    else if (str == "-data-parallel") {
+      // see above, the device is already created
+    }
+    else if (str == "-step-frames") {
+      ospray::impi::Parse<1>(ac, av, i, stepFrames);
+    }
+    else if (str == "-no-prefetch") {
+      prefetchSteps = false;
+    }
+    else if (str == "-temporal-reuse") {
+      temporalReuse = true;
+    }
+    else if (str == "-attribute") {
+      attributeName = av[++i];
+    }
+    else if (str == "-jobs") {
+      jobsName = av[++i];
+    }
     else if (str == "-renderer") {
       rendererName = av[++i];
     }
@@ -737,9 +937,33 @@ int main(int ac, const char** av)
     }
   }
   if (inputFiles.empty()) { throw std::runtime_error("missing input file"); }
-  if (inputFiles.size() > 1) {
-    for (auto& s : inputFiles) std::cout << s << std::endl;
-    throw std::runtime_error("too many input file"); 
+  // more than one file (or a pattern or list of them) is a time series
+  const std::vector<std::string> timeSteps =
+    ospray::impi::ExpandTimeSeries(inputFiles);
+  if (timeSteps.size() > 1) {
+    std::cout << "#osp:bench: time series of " << timeSteps.size() 
+	      << " timesteps" << std::endl;
+    // every timestep gets a model of its own, modes that build models
+    // for the first one only would not make sense
+    if (USE_VIEWER || dataParallel || isoSweepSteps > 0 || 
+	scalingThreads > 0 || abCompare || eyelight || !jobsName.empty() ||
+	!fbSweep.empty() || !sppSweep.empty() || isoMode != IMPI) {
+      throw std::runtime_error("a time series only runs the plain "
+			       "warmup/measure frames of impi surfaces");
+    }
+    if (stepFrames < 1) {
+      throw std::runtime_error("-step-frames needs at least one frame");
+    }
+  }
+  if (dataParallel) {
+    // modes that build models of their own are not distributed
+    if (USE_VIEWER || isoSweepSteps > 0 || scalingThreads > 0 ||
+	abCompare || eyelight || !jobsName.empty() || !fbSweep.empty() ||
+	!sppSweep.empty() || showObject || isoMode != IMPI) {
+      throw std::runtime_error("-data-parallel only runs the plain "
+			       "warmup/measure frames of impi surfaces");
+    }
+    rendererName = "mpi_raycast";
   }
 
 #if USE_VIEWER
@@ -778,8 +1002,29 @@ int main(int ac, const char** av)
     throw std::runtime_error("invalid renderer name: " + rendererName);
   }
 
-  // load amr volume
-  auto amrVolume = ospray::ParseOSP::loadOSP(inputFiles[0]);
+  // load amr or structured volume
+  if (!ospray::impi::ResetPeakResidentMemory()) {
+    std::cout << "#osp:bench: cannot reset peak memory, "
+	      << "peaks are measured from program start" << std::endl;
+  }
+  std::shared_ptr<ospray::VolumeNode> inputVolume;
+  {
+    ospray::impi::TraceScope trace("load");
+    ospray::Partition partition;
+    partition.rank = mpiRank;
+    partition.size = mpiSize;
+    inputVolume = ospray::ParseOSP::loadOSP(timeSteps[0], partition,
+					    attributeName);
+  }
+  MemoryPhase("load");
+#if IMPI_MPI
+  if (dataParallel) {
+    // each rank only saw the values of its bricks
+    float range[2] = {-inputVolume->voxelRange.x, inputVolume->voxelRange.y};
+    MPI_Allreduce(MPI_IN_PLACE, range, 2, MPI_FLOAT, MPI_MAX, MPI_COMM_WORLD);
+    inputVolume->voxelRange = vec2f(-range[0], range[1]);
+  }
+#endif
 
   // setup trasnfer function
   OSPData colorsData = ospNewData(colors.size() / 3, OSP_FLOAT3,
@@ -793,7 +1038,7 @@ int main(int ac, const char** av)
   ospSetData(transferFcn, "opacities", opacitiesData);
   if (valueRange.x > valueRange.y) {
     ospSetVec2f(transferFcn, "valueRange", 
-		(const osp::vec2f&)amrVolume->Range());
+		(const osp::vec2f&)inputVolume->Range());
   } else {
     ospSetVec2f(transferFcn, "valueRange", 
 		(const osp::vec2f&)valueRange);
@@ -803,7 +1048,14 @@ int main(int ac, const char** av)
   ospRelease(opacitiesData);
 
   // setup volume
-  OSPVolume volume = amrVolume->Create(transferFcn);
+  auto tCreate = ospray::impi::Time();
+  OSPVolume volume;
+  {
+    ospray::impi::TraceScope trace("volumeCreate");
+    volume = inputVolume->Create(transferFcn);
+  }
+  const double createTime = ospray::impi::Time(tCreate);
+  MemoryPhase("volumeCreate");
   if (showVolume) {
     ospAddVolume(world, volume);
   }
@@ -823,6 +1075,54 @@ int main(int ac, const char** av)
 
   ospCommit(mtl);
 
+  // material and geometry of one implicit isosurface (the viewer
+  // creates a new geometry whenever an iso-value is edited)
+  auto SetIsoColor = [&](OSPMaterial m, const vec3f& c) {
+    ospSetVec3f(m, rendererName == "scivis" ? "Kd" : "baseColor",
+		(const osp::vec3f&)c);
+  };
+  auto NewIsoMaterial = [&](const vec3f& c) {
+    OSPMaterial m;
+    if (rendererName == "scivis") {
+      m = ospNewMaterial(renderer, "OBJMaterial");
+      SetIsoColor(m, c);
+      ospSetVec3f(m, "Ks", osp::vec3f{0.1f, 0.1f, 0.1f});
+      ospSet1f(m, "Ns", 10.f);
+    } else {
+      //----------------
+      //m = ospNewMaterial(renderer, "ThinGlass");
+      //ospSetVec3f(m, "attenuationColor", (const osp::vec3f&)c);
+      //ospSet1f(m, "thickness", 0.1f);
+      //----------------
+      //m = ospNewMaterial(renderer, "Alloy");
+      //ospSetVec3f(m, "color", (const osp::vec3f&)c);
+      //----------------
+      m = ospNewMaterial(renderer, "MetallicPaint");
+      SetIsoColor(m, c);
+      //----------------
+    }
+    ospCommit(m);
+    return m;
+  };
+  // time series with -temporal-reuse: the i-th surface of a timestep
+  // reuses what the i-th one of the previous timestep extracted
+  auto TemporalKey = [&](const size_t i) {
+    return temporalReuse && timeSteps.size() > 1 ? 
+      "iso" + std::to_string(i) : std::string();
+  };
+  auto NewIsoGeometry = [&](const float v, OSPMaterial m,
+			    const std::string& temporalKey) {
+    OSPGeometry g = ospNewGeometry("impi"); 
+    ospSet1f(g, "isoValue", v);
+    if (!temporalKey.empty()) {
+      ospSetString(g, "temporalKey", temporalKey.c_str());
+    }
+    inputVolume->SetImpiParams(g, volume);
+    ospSetMaterial(g, m); // see performance impact (x7 slower for cosmos)
+    ospCommit(g);
+    return g;
+  };
+
   switch (isoMode) {
   case NORMAL:
     // --> normal isosurface
@@ -905,35 +1205,13 @@ int main(int ac, const char** av)
 
 
       //       we build multiple iso-geometries here      
-      for (auto& v : isoValues) {
+      for (size_t i = 0; i < isoValues.size(); ++i) {
+	auto& v = isoValues[i];
 	std::cout << "v = " << v.v << " "
 		  << "c = " << v.c.x << " " << v.c.y << " " << v.c.z
 		  << std::endl;
-	if (rendererName == "scivis") {
-	  v.mtl = ospNewMaterial(renderer, "OBJMaterial");
-	  ospSetVec3f(v.mtl, "Kd", (const osp::vec3f&)v.c);
-	  ospSetVec3f(v.mtl, "Ks", osp::vec3f{0.1f, 0.1f, 0.1f});
-	  ospSet1f(v.mtl, "Ns", 10.f);
-	  ospCommit(v.mtl);
-	} else {
-	  //----------------
-	  //v.mtl = ospNewMaterial(renderer, "ThinGlass");
-	  //ospSetVec3f(v.mtl, "attenuationColor", (const osp::vec3f&)v.c);
-	  //ospSet1f(v.mtl, "thickness", 0.1f);
-	  //----------------
-	  //v.mtl = ospNewMaterial(renderer, "Alloy");
-	  //ospSetVec3f(v.mtl, "color", (const osp::vec3f&)v.c);
-	  //----------------
-	  v.mtl = ospNewMaterial(renderer, "MetallicPaint");
-	  ospSetVec3f(v.mtl, "baseColor", (const osp::vec3f&)v.c);
-	  //----------------
-	  ospCommit(v.mtl);
-	}
-	v.geo = ospNewGeometry("impi"); 
-	ospSet1f(v.geo, "isoValue", v.v);
-	ospSetObject(v.geo, "amrDataPtr", volume);
-	ospSetMaterial(v.geo, v.mtl); // see performance impact (x7 slower for cosmos)
-	ospCommit(v.geo);
+	v.mtl = NewIsoMaterial(v.c);
+	v.geo = NewIsoGeometry(v.v, v.mtl, TemporalKey(i));
 	ospAddGeometry(world, v.geo);
       }
     }
@@ -952,8 +1230,9 @@ int main(int ac, const char** av)
   affine3f transform = 
     affine3f::translate(objTranslate) * 
     affine3f::scale(objScale);
+  OSPMaterial mtlobj = nullptr;
   if (showObject) {
-    OSPMaterial mtlobj = ospNewMaterial(renderer, "OBJMaterial");
+    mtlobj = ospNewMaterial(renderer, "OBJMaterial");
     ospSetVec3f(mtlobj, "Kd", osp::vec3f{3/255.f, 10/255.f, 25/255.f});
     ospSetVec3f(mtlobj, "Ks", osp::vec3f{77/255.f, 77/255.f, 77/255.f});
     ospSet1f(mtlobj, "Ns", 10.f);
@@ -1000,13 +1279,84 @@ int main(int ac, const char** av)
 
 
   // setup world & renderer
-  ospCommit(world); 
+  // (impi geometries extract their active voxels during this commit,
+  //  embree builds the BVH right after)
+  std::shared_ptr<ospray::amr::AMRVolume> amrPart =
+    std::dynamic_pointer_cast<ospray::amr::AMRVolume>(inputVolume);
+  if (dataParallel && !amrPart) {
+    throw std::runtime_error("-data-parallel needs an AMR volume");
+  }
+  if (dataParallel) {
+    // the region this rank renders, ospray composites them
+    ospSet1i(world, "id", mpiRank);
+    OSPData regions = ospNewData(2, OSP_FLOAT3, &amrPart->region);
+    ospCommit(regions);
+    ospSetData(world, "regions", regions);
+    ospRelease(regions);
+  }
+  ospray::impi::ClearModuleStats();
+  auto tCommit = ospray::impi::Time();
+  {
+    ospray::impi::TraceScope trace("modelCommit");
+    ospCommit(world); 
+  }
+  const double commitTime = ospray::impi::Time(tCommit);
+  const auto impiStats = ospray::impi::GetModuleStats();
+  // data-parallel: what the slowest rank took, and what all loaded
+  // and extracted together (replicated runs report one copy)
+  double dpCommitMax = commitTime, dpExtractMax = 0.0;
+  double dpActive = 0.0, dpBricks = 0.0;
+#if IMPI_MPI
+  if (dataParallel) {
+    for (const auto& s : impiStats) {
+      dpExtractMax += s.extractTime;
+      dpActive     += s.numActiveVoxels;
+    }
+    dpBricks = amrPart->brickInfo.size();
+    double vmax[2] = {dpCommitMax, dpExtractMax};
+    double vsum[2] = {dpActive, dpBricks};
+    MPI_Allreduce(MPI_IN_PLACE, vmax, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, vsum, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    dpCommitMax  = vmax[0];
+    dpExtractMax = vmax[1];
+    dpActive     = vsum[0];
+    dpBricks     = vsum[1];
+    std::cout << "#osp:bench: data-parallel rank " << mpiRank << ": "
+	      << amrPart->brickInfo.size() << " bricks, commit " 
+	      << commitTime << "s; all ranks: " << dpBricks << " bricks, " 
+	      << dpActive << " active voxels, slowest commit " << dpCommitMax 
+	      << "s, slowest extraction " << dpExtractMax << "s" << std::endl;
+  }
+#endif
+  MemoryPhase("modelCommit");
+  int64_t embreeBytes = 0, embreePeakBytes = 0;
+  const bool hasEmbreeMemory =
+    ospray::impi::EmbreeMemory(embreeBytes, embreePeakBytes);
+  {
+    uint64_t sourceBytes = 0, refBytes = 0, stagingBytes = 0, active = 0;
+    for (const auto& s : impiStats) {
+      sourceBytes  += s.sourceBytes;
+      refBytes     += s.refBytes;
+      stagingBytes += s.stagingBytes;
+      active       += s.numActiveVoxels;
+    }
+    if (!impiStats.empty()) {
+      const double MB = 1024.0 * 1024.0;
+      std::cout << "#osp:bench: impi memory: voxels " << sourceBytes / MB
+		<< " MB, refs " << refBytes / MB << " MB, staging peak " 
+		<< stagingBytes / MB << " MB, "
+		<< (active ? double(sourceBytes + refBytes) / active : 0.0)
+		<< " bytes per active voxel" << std::endl;
+      std::cout << "#osp:bench: embree memory: " << embreeBytes / MB 
+		<< " MB (peak " << embreePeakBytes / MB << " MB)" << std::endl;
+    }
+  }
   ospSetVec3f(renderer, "bgColor", 
 	      osp::vec3f{1.f, 1.f, 1.f});
   ospSetData(renderer, "lights", lights);
   ospSetObject(renderer, "model", world);
   ospSetObject(renderer, "camera", camera);
-  ospSet1i(renderer, "shadowEnabled", 1);
+  ospSet1i(renderer, "shadowsEnabled", 1);
   ospSet1i(renderer, "oneSidedLighting", 1);
   ospSet1i(renderer, "maxDepth", 100);
   ospSet1i(renderer, "spp", 1);
@@ -1018,6 +1368,7 @@ int main(int ac, const char** av)
   ospSet1f(renderer, "minContribution", 0.001f);
   ospCommit(renderer);
 
+  int exitCode = 0; // non-zero if a check in one of the modes failed
 
 #if USE_VIEWER
 
@@ -1027,42 +1378,989 @@ int main(int ac, const char** av)
                   (const osp::vec3f &)vp,
                   (const osp::vec3f &)vu,
                   (const osp::vec3f &)vi);
-  viewer::Handler(transferFcn, amrVolume->Range().x, amrVolume->Range().y);
-  viewer::Handler(world, renderer);
+  viewer::Handler(transferFcn, inputVolume->Range().x, inputVolume->Range().y);
+  // iso-values edited in the viewer are rebuilt on its background
+  // thread, which only creates new objects: every surface and the mesh
+  // sit in a model of their own that the world instances, so an edit
+  // extracts and builds just that surface, and the new world only
+  // builds its top-level BVH over the volume and the instances. the
+  // surfaces keep their materials, a color edit only updates those
+  struct ViewerSurface {
+    float value;
+    OSPModel model;
+    OSPGeometry instance;
+  };
+  std::vector<ViewerSurface> viewerSurfaces; // the rebuild's, after setup
+  OSPGeometry meshInstance = nullptr;
+  auto NewViewerSurface = [&](const float v, OSPGeometry g) {
+    ViewerSurface s{v, ospNewModel(), nullptr};
+    ospAddGeometry(s.model, g);
+    ospCommit(s.model);
+    s.instance = ospNewInstance(s.model, (const osp::affine3f&)Identity);
+    ospCommit(s.instance);
+    return s;
+  };
+  auto NewViewerWorld = [&]() {
+    OSPModel model = ospNewModel();
+    if (showVolume) {
+      ospAddVolume(model, volume);
+    }
+    if (meshInstance) {
+      ospAddGeometry(model, meshInstance);
+    }
+    for (const auto& s : viewerSurfaces) {
+      ospAddGeometry(model, s.instance);
+    }
+    ospCommit(model);
+    return model;
+  };
+  OSPModel viewerWorld = world;
+  if (isoMode == IMPI) {
+    // the surfaces move out of 'world' (no re-extraction, their BVHs
+    // are built again once), which is not rendered from here on
+    for (const auto& v : isoValues) {
+      viewerSurfaces.push_back(NewViewerSurface(v.v, v.geo));
+    }
+    if (showObject) {
+      OSPModel meshModel = ospNewModel();
+      mesh.AddToModel(meshModel, renderer, mtlobj);
+      ospCommit(meshModel);
+      meshInstance = ospNewInstance(meshModel, 
+				    (const osp::affine3f&)Identity);
+      ospCommit(meshInstance);
+      ospRelease(meshModel);
+    }
+    viewerWorld = NewViewerWorld();
+    ospSetObject(renderer, "model", viewerWorld);
+    ospCommit(renderer);
+  }
+  viewer::Handler(viewerWorld, renderer);
+  // what the HUD shows about the last (re)build of the world
+  auto UpdateBuildStats = [](const double commitTime) {
+    viewer::BuildStats b;
+    double finalizeTime = 0.0;
+    for (const auto& s : ospray::impi::GetModuleStats()) {
+      b.extractTime  += s.extractTime;
+      b.activeVoxels += s.numActiveVoxels;
+      finalizeTime   += s.finalizeTime;
+    }
+    b.bvhTime = std::max(commitTime - finalizeTime, 0.0);
+    viewer::SetBuildStats(b);
+  };
+  UpdateBuildStats(commitTime);
+  if (isoMode == IMPI) {
+    std::vector<viewer::IsoSurface> surfaces;
+    for (const auto& v : isoValues) {
+      surfaces.push_back({v.v, (const osp::vec3f&)v.c});
+    }
+    // module stats only exist with the local device, a distributed one
+    // must not be called from two threads and rebuilds between frames
+    const bool background = ospray::impi::HasModuleStats();
+    viewer::Handler(surfaces, inputVolume->Range().x, inputVolume->Range().y,
+		    [&](const std::vector<viewer::IsoSurface>& isos) {
+		      ospray::impi::TraceScope trace("viewerRebuild");
+		      ospray::impi::ClearModuleStats();
+		      auto tc = ospray::impi::Time();
+		      bool changed = false;
+		      for (size_t i = 0; i < isos.size(); ++i) {
+			auto& s = viewerSurfaces[i];
+			if (isos[i].value == s.value) { continue; }
+			// the world being rendered still holds the old ones
+			ospRelease(s.instance);
+			ospRelease(s.model);
+			OSPGeometry g = NewIsoGeometry(isos[i].value, 
+						       isoValues[i].mtl, "");
+			s = NewViewerSurface(isos[i].value, g);
+			ospRelease(g);
+			changed = true;
+		      }
+		      if (!changed) { return OSPModel(nullptr); }
+		      OSPModel model = NewViewerWorld();
+		      UpdateBuildStats(ospray::impi::Time(tc));
+		      return model;
+		    },
+		    [&](size_t i, const osp::vec3f& c) {
+		      isoValues[i].c = (const vec3f&)c;
+		      SetIsoColor(isoValues[i].mtl, isoValues[i].c);
+		      ospCommit(isoValues[i].mtl);
+		    },
+		    [](uint64_t& done, uint64_t& total) {
+		      ospray::impi::ExtractProgress(done, total);
+		    },
+		    background);
+  }
   viewer::Render(window);
 
 #else
 
+  // camera path mode: every measured frame gets its own view and is
+  // rendered from scratch (no accumulation), so that the frame times
+  // of different views can be told apart
+  const bool usePath = !cameraPathName.empty() || cameraOrbit;
+  ospray::impi::CameraPath path;
+  if (!cameraPathName.empty()) {
+    path = ospray::impi::CameraPath::Load(cameraPathName);
+  } else if (cameraOrbit) {
+    path = ospray::impi::CameraPath::Orbit(inputVolume->bounds, vu);
+  }
+  if (usePath) {
+    std::cout << "#osp:bench: camera path with " << path.NumKeys()
+              << " keyframes over " << numFrames.y << " frames" << std::endl;
+  }
+  std::vector<ospray::impi::CameraKey> views;
+  auto SetView = [&](const ospray::impi::CameraKey& k) {
+    const vec3f dir = k.vi - k.vp;
+    ospSetVec3f(camera, "pos", (const osp::vec3f&)k.vp);
+    ospSetVec3f(camera, "dir", (const osp::vec3f&)dir);
+    ospSetVec3f(camera, "up",  (const osp::vec3f&)k.vu);
+    ospCommit(camera);
+  };
+  const int fbChannels = usePath ? 
+    OSP_FB_COLOR : OSP_FB_COLOR | OSP_FB_ACCUM;
+
   // setup framebuffer
   OSPFrameBuffer fb = ospNewFrameBuffer((const osp::vec2i&)imgSize, 
-					OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
-  ospFrameBufferClear(fb, OSP_FB_COLOR | OSP_FB_ACCUM);
+					OSP_FB_SRGBA, fbChannels);
+  ospFrameBufferClear(fb, fbChannels);
+  auto DumpFrame = [&](const int frame) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%04d.ppm", frame);
+    if (mpiRank != 0) return;
+    const uint32_t * buffer = (uint32_t*)ospMapFrameBuffer(fb, OSP_FB_COLOR);
+    ospray::impi::writePPM(outputImageName + suffix, imgSize.x, imgSize.y, buffer);
+    ospUnmapFrameBuffer(buffer, fb);
+  };
 
   // render 10 more frames, which are accumulated to result in a better converged image
+  std::vector<double> warmupTimes, frameTimes;
   std::cout << "#osp:bench: start warmups for " 
 	    << numFrames.x << " frames" << std::endl;
+  if (usePath) SetView(path.Frame(0, numFrames.y));
   for (int frames = 0; frames < numFrames.x; frames++) { // skip some frames to warmup
-    ospRenderFrame(fb, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
+    if (usePath) ospFrameBufferClear(fb, fbChannels);
+    ospray::impi::TraceScope trace("warmup frame");
+    auto tf = ospray::impi::Time();
+    ospRenderFrame(fb, renderer, fbChannels);
+    warmupTimes.push_back(ospray::impi::Time(tf));
   }
   std::cout << "#osp:bench: done warmups" << std::endl;
   std::cout << "#osp:bench: start benchmarking for "
 	    << numFrames.y << " frames" << std::endl;
-  auto t = ospray::impi::Time();
+  double et = 0.0;
   for (int frames = 0; frames < numFrames.y; frames++) {
-    ospRenderFrame(fb, renderer, OSP_FB_COLOR | OSP_FB_ACCUM);
+    if (usePath) {
+      views.push_back(path.Frame(frames, numFrames.y));
+      SetView(views.back());
+      ospFrameBufferClear(fb, fbChannels);
+    }
+    ospray::impi::TraceScope trace("frame");
+    auto tf = ospray::impi::Time();
+    ospRenderFrame(fb, renderer, fbChannels);
+    frameTimes.push_back(ospray::impi::Time(tf));
+    et += frameTimes.back();
+    if (dumpFrames) DumpFrame(frames);
   }
-  auto et = ospray::impi::Time(t);
+  MemoryPhase("render");
   std::cout << "#osp:bench: done benchmarking" << std::endl;
   std::cout << "#osp:bench: average framerate: " << numFrames.y/et << std::endl; 
+  std::cout << "#osp:bench: frame time p50/p90/p99: "
+            << ospray::impi::Percentile(frameTimes, 50) << " / "
+            << ospray::impi::Percentile(frameTimes, 90) << " / "
+            << ospray::impi::Percentile(frameTimes, 99) << std::endl;
+  if (usePath && !frameTimes.empty()) {
+    const auto slowest = std::max_element(frameTimes.begin(), frameTimes.end())
+      - frameTimes.begin();
+    const auto& k = views[slowest];
+    std::cout << "#osp:bench: slowest view: frame " << slowest
+              << " (" << frameTimes[slowest] << "s)"
+              << " -vp " << k.vp.x << " " << k.vp.y << " " << k.vp.z
+              << " -vi " << k.vi.x << " " << k.vi.y << " " << k.vi.z
+              << " -vu " << k.vu.x << " " << k.vu.y << " " << k.vu.z
+              << std::endl;
+  }
 
   // save frame
-  const uint32_t * buffer = (uint32_t*)ospMapFrameBuffer(fb, OSP_FB_COLOR);
-  ospray::impi::writePPM(outputImageName + ".ppm", imgSize.x, imgSize.y, buffer);
-  ospUnmapFrameBuffer(buffer, fb);
+  if (mpiRank == 0) {
+    const uint32_t * buffer = (uint32_t*)ospMapFrameBuffer(fb, OSP_FB_COLOR);
+    ospray::impi::writePPM(outputImageName + ".ppm", imgSize.x, imgSize.y, buffer);
+    ospUnmapFrameBuffer(buffer, fb);
+  }
+  // the modes below measure the -vp/-vi/-vu view, not the path's end
+  if (usePath) SetView(ospray::impi::CameraKey{vp, vi, vu});
+
+  // helpers for the sweep modes below: commit a model and collect what
+  // its impi geometries recorded, and time a batch of frames
+  struct ModelCommit {
+    double commitTime{0.0}, extractTime{0.0}, finalizeTime{0.0};
+    double bvhTime{0.0};
+    size_t numActiveVoxels{0};
+  };
+  auto CommitModel = [&](OSPModel model) {
+    ModelCommit r;
+    ospray::impi::ClearModuleStats();
+    ospray::impi::TraceScope trace("modelCommit");
+    auto tc = ospray::impi::Time();
+    ospCommit(model);
+    r.commitTime = ospray::impi::Time(tc);
+    for (const auto& s : ospray::impi::GetModuleStats()) {
+      r.extractTime     += s.extractTime;
+      r.finalizeTime    += s.finalizeTime;
+      r.numActiveVoxels += s.numActiveVoxels;
+    }
+    r.bvhTime = std::max(r.commitTime - r.finalizeTime, 0.0);
+    return r;
+  };
+  auto AverageFrameTime = [&]() {
+    ospFrameBufferClear(fb, fbChannels);
+    for (int frames = 0; frames < numFrames.x; frames++) {
+      ospRenderFrame(fb, renderer, fbChannels);
+    }
+    auto tf = ospray::impi::Time();
+    for (int frames = 0; frames < numFrames.y; frames++) {
+      ospRenderFrame(fb, renderer, fbChannels);
+    }
+    return numFrames.y > 0 ? ospray::impi::Time(tf) / numFrames.y : 0.0;
+  };
+  // one impi geometry with the first iso-value in a model of its own
+  OSPMaterial smtl = ospNewMaterial(renderer, "OBJMaterial");
+  ospSetVec3f(smtl, "Kd", (const osp::vec3f&)isoValues[0].c);
+  ospSetVec3f(smtl, "Ks", osp::vec3f{0.1f, 0.1f, 0.1f});
+  ospSet1f(smtl, "Ns", 10.f);
+  ospCommit(smtl);
+  auto NewImpiModel = [&](OSPGeometry& geo, const char* storage) {
+    OSPModel model = ospNewModel();
+    geo = ospNewGeometry("impi"); 
+    if (storage) ospSetString(geo, "amrStorage", storage);
+    inputVolume->SetImpiParams(geo, volume);
+    ospSetMaterial(geo, smtl);
+    ospSet1f(geo, "isoValue", isoValues[0].v);
+    ospCommit(geo);
+    ospAddGeometry(model, geo);
+    return model;
+  };
+
+  // iso-value sweep: for each storage strategy one fresh impi geometry
+  // is re-committed with every iso-value, measuring how extraction and
+  // BVH build scale with the size of the active set
+  ospray::impi::Report report;
+
+  // time series playback: timestep 0 is what was measured above, every
+  // further one gets a volume, impi geometries and a model of its own.
+  // with prefetching, the files of timestep t+1 are read and converted
+  // on a thread of its own while t renders. ospray's api is not
+  // thread-safe, so the volume, the geometries and the model (i.e.
+  // extraction and BVH build) are still created and committed here,
+  // between the frames of t and t+1
+  if (timeSteps.size() > 1) {
+    struct TimeStep {
+      std::shared_ptr<ospray::VolumeNode> node;
+      OSPModel model{nullptr};
+      double createTime{0.0}, commitTime{0.0}, extractTime{0.0};
+      size_t numActiveVoxels{0};
+      size_t numLeaves{0}, reusedLeaves{0};
+    };
+    // no ospray calls in here, it runs on the prefetch thread
+    auto LoadStep = [&](const size_t t) {
+      ospray::impi::TraceScope trace("timestep load");
+      TimeStep step;
+      step.node = ospray::ParseOSP::loadOSP(timeSteps[t], ospray::Partition(),
+					     attributeName);
+      return step;
+    };
+    auto CommitStep = [&](TimeStep& step) {
+      ospray::impi::TraceScope trace("timestep commit");
+      auto tc = ospray::impi::Time();
+      OSPVolume stepVolume = step.node->Create(transferFcn);
+      step.createTime = ospray::impi::Time(tc);
+      step.model = ospNewModel();
+      if (showVolume) {
+	ospAddVolume(step.model, stepVolume);
+      }
+      for (size_t i = 0; i < isoValues.size(); ++i) {
+	OSPGeometry g = ospNewGeometry("impi");
+	ospSet1f(g, "isoValue", isoValues[i].v);
+	if (temporalReuse) {
+	  ospSetString(g, "temporalKey", TemporalKey(i).c_str());
+	}
+	step.node->SetImpiParams(g, stepVolume);
+	ospSetMaterial(g, isoValues[i].mtl);
+	ospCommit(g);
+	ospAddGeometry(step.model, g);
+	ospRelease(g);
+      }
+      if (showObject) {
+	mesh.AddToModel(step.model, renderer, mtlobj);
+      }
+      ospray::impi::ClearModuleStats();
+      tc = ospray::impi::Time();
+      ospCommit(step.model);
+      step.commitTime = ospray::impi::Time(tc);
+      for (const auto& s : ospray::impi::GetModuleStats()) {
+	step.extractTime     += s.extractTime;
+	step.numActiveVoxels += s.numActiveVoxels;
+	step.numLeaves       += s.numLeaves;
+	step.reusedLeaves    += s.reusedLeaves;
+      }
+    };
+
+    std::cout << "#osp:bench: time series playback, " << stepFrames
+	      << " frame(s) per timestep, " 
+	      << (prefetchSteps ? "prefetching" : "no prefetching")
+	      << (temporalReuse ? ", temporal reuse" : "") << std::endl;
+    std::cout << "#osp:bench: step load(s) convert(s) commit(s) "
+	      << "activeVoxels reused wait(s) swap(s) firstFrame(s) "
+	      << "latency(s)" << std::endl;
+    auto& tb = report.AddTable("timeSeries",
+			       {"step", "loadTime", "convertTime",
+				"volumeCreateTime", "commitTime",
+				"extractTime", "activeVoxels", "leaves",
+				"reusedLeaves", "waitTime", "swapTime",
+				"firstFrameTime", "latency", "frameTime"});
+    // timestep 0 was built up front, nothing overlapped it
+    std::vector<double> latencies;
+    double totalLeaves = 0.0, totalReused = 0.0;
+    {
+      double extract = 0.0, active = 0.0, leaves = 0.0;
+      for (const auto& s : impiStats) {
+	extract += s.extractTime;
+	active  += s.numActiveVoxels;
+	leaves  += s.numLeaves;
+      }
+      const double build = inputVolume->loadTime + inputVolume->convertTime
+	+ createTime + commitTime;
+      const double first = !warmupTimes.empty() ? warmupTimes.front() :
+	!frameTimes.empty() ? frameTimes.front() : 0.0;
+      latencies.push_back(build + first);
+      tb.Row({0.0, inputVolume->loadTime, inputVolume->convertTime,
+	      createTime, commitTime, extract, active, leaves, 0.0, build,
+	      0.0, first, latencies.back(),
+	      numFrames.y > 0 ? et / numFrames.y : 0.0});
+    }
+    std::future<TimeStep> next;
+    if (prefetchSteps) {
+      next = std::async(std::launch::async, LoadStep, 1);
+    }
+    TimeStep current;
+    double totalWait = 0.0;
+    auto tPlayback = ospray::impi::Time();
+    for (size_t t = 1; t < timeSteps.size(); ++t) {
+      auto tw = ospray::impi::Time();
+      TimeStep step = prefetchSteps ? next.get() : LoadStep(t);
+      const double wait = ospray::impi::Time(tw);
+      CommitStep(step);
+      auto ts = ospray::impi::Time();
+      ospSetObject(renderer, "model", step.model);
+      ospCommit(renderer);
+      const double swap = ospray::impi::Time(ts);
+      // the renderer let go of the previous timestep
+      if (current.model) ospRelease(current.model);
+      current = std::move(step);
+      if (prefetchSteps && t + 1 < timeSteps.size()) {
+	next = std::async(std::launch::async, LoadStep, t + 1);
+      }
+      ospFrameBufferClear(fb, fbChannels);
+      double first = 0.0, frames = 0.0;
+      for (int f = 0; f < stepFrames; ++f) {
+	ospray::impi::TraceScope trace("timestep frame");
+	auto tf = ospray::impi::Time();
+	ospRenderFrame(fb, renderer, fbChannels);
+	const double ft = ospray::impi::Time(tf);
+	if (f == 0) first = ft;
+	frames += ft;
+      }
+      if (dumpFrames) {
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "_t%04d.ppm", int(t));
+	const uint32_t * buffer = 
+	  (uint32_t*)ospMapFrameBuffer(fb, OSP_FB_COLOR);
+	ospray::impi::writePPM(outputImageName + suffix, 
+			       imgSize.x, imgSize.y, buffer);
+	ospUnmapFrameBuffer(buffer, fb);
+      }
+      totalWait   += wait;
+      totalLeaves += current.numLeaves;
+      totalReused += current.reusedLeaves;
+      latencies.push_back(wait + current.createTime + current.commitTime +
+			  swap + first);
+      const auto& n = *current.node;
+      std::cout << "#osp:bench: " << t << " " << n.loadTime << " " 
+		<< n.convertTime << " " << current.commitTime << " " 
+		<< current.numActiveVoxels << " " << current.reusedLeaves
+		<< "/" << current.numLeaves << " " << wait << " " << swap 
+		<< " " << first << " " << latencies.back() << std::endl;
+      tb.Row({(double)t, n.loadTime, n.convertTime, current.createTime,
+	      current.commitTime, current.extractTime,
+	      (double)current.numActiveVoxels, (double)current.numLeaves,
+	      (double)current.reusedLeaves, wait, swap, first,
+	      latencies.back(), frames / stepFrames});
+    }
+    const double playbackTime = ospray::impi::Time(tPlayback);
+    std::cout << "#osp:bench: played " << timeSteps.size() - 1 
+	      << " timesteps in " << playbackTime << "s, waited " 
+	      << totalWait << "s for them, latency p50/p90: "
+	      << ospray::impi::Percentile(latencies, 50) << " / "
+	      << ospray::impi::Percentile(latencies, 90) << std::endl;
+    report.Set("timeSeries", "prefetch", prefetchSteps ? 1.0 : 0.0);
+    report.Set("timeSeries", "stepFrames", (double)stepFrames);
+    report.Set("timeSeries", "waitTime", totalWait);
+    if (temporalReuse) {
+      // of the leaves of timesteps 1.., timestep 0 has nothing to reuse
+      const double fraction = 
+	totalLeaves > 0.0 ? totalReused / totalLeaves : 0.0;
+      std::cout << "#osp:bench: temporal reuse of " << 100.0 * fraction
+		<< "% of the leaves" << std::endl;
+      report.Set("timeSeries", "reuseFraction", fraction);
+    }
+    report.Phase("timeSeriesPlayback", playbackTime);
+    report.Frames("stepLatency", latencies);
+    // back to timestep 0
+    ospSetObject(renderer, "model", world);
+    ospCommit(renderer);
+    if (current.model) ospRelease(current.model);
+  }
+
+  if (isoSweepSteps > 0) {
+    for (const std::string storage : {"active", "none"}) {
+      std::cout << "#osp:bench: iso-value sweep (storage " << storage << ")" 
+		<< std::endl;
+      std::cout << "#osp:bench: isoValue activeVoxels extract(s) bvh(s) "
+		<< "commit(s) rss(MB) frame(s)" << std::endl;
+      auto& tb = report.AddTable("isoSweep." + storage, 
+				 {"isoValue", "activeVoxels", "extractTime",
+				  "bvhBuildTime", "commitTime", "rss",
+				  "frameTime"});
+      OSPGeometry geo;
+      OSPModel sweepModel = NewImpiModel(geo, storage.c_str());
+      for (int step = 0; step < isoSweepSteps; ++step) {
+	const float v = isoSweepSteps > 1 ?
+	  isoSweepRange.x + (isoSweepRange.y - isoSweepRange.x) * 
+	  step / float(isoSweepSteps - 1) : isoSweepRange.x;
+	ospSet1f(geo, "isoValue", v);
+	ospCommit(geo);
+	const auto st = CommitModel(sweepModel);
+	const size_t rss = ospray::impi::ResidentMemory();
+	if (step == 0) {
+	  ospSetObject(renderer, "model", sweepModel);
+	  ospCommit(renderer);
+	}
+	const double frame = AverageFrameTime();
+	std::cout << "#osp:bench: " << v << " " << st.numActiveVoxels << " " 
+		  << st.extractTime << " " << st.bvhTime << " " 
+		  << st.commitTime << " " << rss / (1024.0 * 1024.0) << " " 
+		  << frame << std::endl;
+	tb.Row({v, (double)st.numActiveVoxels, st.extractTime, st.bvhTime, 
+		st.commitTime, (double)rss, frame});
+      }
+      ospRelease(geo);
+      ospRelease(sweepModel);
+    }
+    ospSetObject(renderer, "model", world);
+    ospCommit(renderer);
+  }
+
+  // thread scaling: extraction, BVH build and rendering with 1, 2, 4,
+  // ... threads. ospray is asked to re-initialize its tasking system,
+  // which embree shares, by committing the device with a new thread
+  // count. whether it did is not guaranteed (e.g. a tbb scheduler that
+  // is still alive keeps its concurrency), so the threads that really
+  // run tasks are counted and a run on the wrong count aborts. every
+  // run gets a fresh impi geometry, otherwise the active voxels would
+  // not be extracted again
+  if (scalingThreads > 0) {
+    std::vector<int> threadCounts;
+    for (int t = 1; t < scalingThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(scalingThreads);
+    std::vector<ModelCommit> commits;
+    std::vector<double> frameTimes;
+    for (const int t : threadCounts) {
+      std::cout << "#osp:bench: thread scaling with " << t << " threads" 
+		<< std::endl;
+      ospDeviceSet1i(device, "numThreads", t);
+      ospDeviceCommit(device);
+      const int active = ActiveThreads();
+      if (active != t) {
+	throw std::runtime_error("thread scaling: asked ospray for " +
+				 std::to_string(t) + " threads, tasks ran on " +
+				 std::to_string(active));
+      }
+      OSPGeometry geo;
+      OSPModel model = NewImpiModel(geo, nullptr);
+      commits.push_back(CommitModel(model));
+      ospSetObject(renderer, "model", model);
+      ospCommit(renderer);
+      frameTimes.push_back(AverageFrameTime());
+      ospSetObject(renderer, "model", world);
+      ospCommit(renderer);
+      ospRelease(geo);
+      ospRelease(model);
+    }
+    // restore what ospray was started with
+    ospDeviceSet1i(device, "numThreads", launchThreads);
+    ospDeviceCommit(device);
+
+    auto& tb = report.AddTable("threadScaling",
+			       {"threads", "extractTime", "bvhBuildTime",
+				"frameTime", "extractSpeedup", "bvhSpeedup",
+				"frameSpeedup"});
+    std::cout << "#osp:bench: threads | extract(s) speedup eff. | "
+	      << "bvh(s) speedup eff. | frame(s) speedup eff." << std::endl;
+    const auto& c1 = commits.front();
+    for (size_t i = 0; i < threadCounts.size(); ++i) {
+      const double n  = threadCounts[i];
+      const auto& c   = commits[i];
+      const double se = c.extractTime  > 0.0 ? c1.extractTime / c.extractTime : 0.0;
+      const double sb = c.bvhTime      > 0.0 ? c1.bvhTime / c.bvhTime : 0.0;
+      const double sf = frameTimes[i]  > 0.0 ? frameTimes[0] / frameTimes[i] : 0.0;
+      std::cout << "#osp:bench: " << std::setw(7) << threadCounts[i]
+		<< " | " << c.extractTime << " " << se << " " << se / n
+		<< " | " << c.bvhTime << " " << sb << " " << sb / n
+		<< " | " << frameTimes[i] << " " << sf << " " << sf / n
+		<< std::endl;
+      tb.Row({n, c.extractTime, c.bvhTime, frameTimes[i], se, sb, sf});
+    }
+  }
+
+  // A/B comparison: the same view rendered with the impi geometry and
+  // with ospray's builtin "isosurfaces" geometry, for all iso-values and
+  // with the same material. reports frame rates and image differences
+  // between the two and against an optional reference image
+  if (abCompare) {
+    std::vector<float> vlist;
+    for (const auto& v : isoValues) vlist.push_back(v.v);
+    OSPModel impiModel = ospNewModel();
+    std::vector<OSPGeometry> impiGeos;
+    for (const float v : vlist) {
+      OSPGeometry geo = ospNewGeometry("impi"); 
+      inputVolume->SetImpiParams(geo, volume);
+      ospSet1f(geo, "isoValue", v);
+      ospSetMaterial(geo, smtl);
+      ospCommit(geo);
+      ospAddGeometry(impiModel, geo);
+      impiGeos.push_back(geo);
+    }
+    ospCommit(impiModel);
+    OSPModel builtinModel = ospNewModel();
+    OSPGeometry niso = ospNewGeometry("isosurfaces");
+    OSPData niso_values = ospNewData(vlist.size(), OSP_FLOAT, vlist.data());
+    ospSetData(niso, "isovalues", niso_values);
+    ospSetObject(niso, "volume", volume);
+    ospSetMaterial(niso, smtl);
+    ospCommit(niso);
+    ospAddGeometry(builtinModel, niso);
+    ospCommit(builtinModel);
+
+    auto RenderImage = [&](OSPModel model, const std::string& name,
+			   double& fps) {
+      ospSetObject(renderer, "model", model);
+      ospCommit(renderer);
+      const double frame = AverageFrameTime();
+      fps = frame > 0.0 ? 1.0 / frame : 0.0;
+      ospray::impi::Image img;
+      img.width  = imgSize.x;
+      img.height = imgSize.y;
+      const uint32_t* buffer = 
+	(const uint32_t*)ospMapFrameBuffer(fb, OSP_FB_COLOR);
+      img.pixels.assign(buffer, buffer + size_t(imgSize.x) * imgSize.y);
+      ospUnmapFrameBuffer(buffer, fb);
+      ospray::impi::writePPM(outputImageName + "_" + name + ".ppm",
+			     imgSize.x, imgSize.y, img.pixels.data());
+      return img;
+    };
+    double impiFps = 0.0, builtinFps = 0.0;
+    const auto impiImg    = RenderImage(impiModel, "impi", impiFps);
+    const auto builtinImg = RenderImage(builtinModel, "builtin", builtinFps);
+    ospSetObject(renderer, "model", world);
+    ospCommit(renderer);
+
+    auto PrintDiff = [&](const std::string& name,
+			 const ospray::impi::ImageDiff& d) {
+      std::cout << "#osp:bench: " << name << ": rmse " << d.rmse
+		<< " psnr " << d.psnr << " dB, " << d.differing 
+		<< " differing pixels ("
+		<< 100.0 * d.differing / impiImg.pixels.size() << "%)"
+		<< std::endl;
+      report.Set("abCompare", name + ".rmse", d.rmse);
+      report.Set("abCompare", name + ".psnr", d.psnr);
+      report.Set("abCompare", name + ".differingPixels", (double)d.differing);
+      if (abMinPSNR > 0.f && d.psnr < abMinPSNR) {
+	std::cout << "#osp:bench: " << name << " is below " << abMinPSNR
+		  << " dB" << std::endl;
+	exitCode = 2;
+      }
+    };
+    std::cout << "#osp:bench: impi " << impiFps << " fps, builtin " 
+	      << builtinFps << " fps" << std::endl;
+    report.Set("abCompare", "impiFps", impiFps);
+    report.Set("abCompare", "builtinFps", builtinFps);
+    PrintDiff("impiVsBuiltin", 
+	      ospray::impi::CompareImages(impiImg, builtinImg));
+    if (!abReference.empty()) {
+      const auto ref = ospray::impi::ReadPPM(abReference);
+      report.Set("abCompare", "reference", abReference);
+      PrintDiff("impiVsReference", ospray::impi::CompareImages(impiImg, ref));
+      PrintDiff("builtinVsReference", 
+		ospray::impi::CompareImages(builtinImg, ref));
+    }
+
+    for (auto geo : impiGeos) ospRelease(geo);
+    ospRelease(impiModel);
+    ospRelease(niso_values);
+    ospRelease(niso);
+    ospRelease(builtinModel);
+  }
+
+  // geometry-only throughput: the same view with a renderer that only
+  // shades primary hits by the eye light, then scivis with secondary
+  // rays added one kind at a time (no accumulation). every rate counts
+  // primary rays (one per pixel), so the difference to 'primary' is
+  // what shading, shadow and AO rays cost on top of the traversal
+  if (eyelight) {
+    struct Config {
+      const char* name;
+      const char* type;
+      int shadows, aoSamples;
+    };
+    const Config configs[] = {
+      {"primary",   "raycast_eyelight", 0, 0},
+      {"shading",   "scivis",           0, 0},
+      {"shadows",   "scivis",           1, 0},
+      {"ao",        "scivis",           0, 1},
+      {"shadowsAO", "scivis",           1, 1},
+    };
+    OSPFrameBuffer efb = ospNewFrameBuffer((const osp::vec2i&)imgSize, 
+					   OSP_FB_SRGBA, OSP_FB_COLOR);
+    const double rays = double(imgSize.x) * imgSize.y;
+    double primaryTime = 0.0;
+    std::cout << "#osp:bench: eyelight config frame(s) Mrays/s relative" 
+	      << std::endl;
+    for (const auto& c : configs) {
+      OSPRenderer r = ospNewRenderer(c.type);
+      ospSetObject(r, "model", world);
+      ospSetObject(r, "camera", camera);
+      ospSetData(r, "lights", lights);
+      ospSetVec3f(r, "bgColor", osp::vec3f{1.f, 1.f, 1.f});
+      ospSet1i(r, "spp", 1);
+      ospSet1i(r, "shadowsEnabled", c.shadows);
+      ospSet1i(r, "aoSamples", c.aoSamples);
+      ospSet1f(r, "aoDistance", 10000.0f);
+      ospSet1i(r, "oneSidedLighting", 1);
+      ospSet1i(r, "autoEpsilon", 1);
+      ospCommit(r);
+      for (int frames = 0; frames < numFrames.x; frames++) {
+	ospRenderFrame(efb, r, OSP_FB_COLOR);
+      }
+      double frame = 0.0;
+      {
+	ospray::impi::TraceScope trace(c.name);
+	auto tf = ospray::impi::Time();
+	for (int frames = 0; frames < numFrames.y; frames++) {
+	  ospRenderFrame(efb, r, OSP_FB_COLOR);
+	}
+	frame = numFrames.y > 0 ? ospray::impi::Time(tf) / numFrames.y : 0.0;
+      }
+      ospRelease(r);
+      if (primaryTime == 0.0) primaryTime = frame;
+      const double mrays = frame > 0.0 ? rays / frame * 1e-6 : 0.0;
+      const double relative = primaryTime > 0.0 ? frame / primaryTime : 0.0;
+      std::cout << "#osp:bench: eyelight " << c.name << " " << frame << " " 
+		<< mrays << " " << relative << std::endl;
+      report.Set("eyelight", std::string(c.name) + ".frameTime", frame);
+      report.Set("eyelight", std::string(c.name) + ".mrays", mrays);
+    }
+    ospFreeFrameBuffer(efb);
+  }
+
+  // resolution and spp sweeps: the same view with different numbers of
+  // primary rays per frame (no accumulation). the fit 
+  // frame time = fixed + rays * per ray
+  // separates what every frame costs anyway (clears, tile scheduling,
+  // commit checks) from the cost of tracing a ray
+  auto RaySweep = [&](const std::string& name, 
+		      const std::vector<vec2i>& sizes,
+		      const std::vector<int>& spps) {
+    auto& tb = report.AddTable(name, {"width", "height", "spp", "rays",
+				      "frameTime", "nsPerRay"});
+    std::cout << "#osp:bench: " << name << ": width height spp Mrays "
+	      << "frame(s) ns/ray" << std::endl;
+    std::vector<double> xs, ys;
+    for (const vec2i& size : sizes) {
+      OSPFrameBuffer sfb = ospNewFrameBuffer((const osp::vec2i&)size, 
+					     OSP_FB_SRGBA, OSP_FB_COLOR);
+      ospSet1f(camera, "aspect", size.x / (float)size.y);
+      ospCommit(camera);
+      for (const int spp : spps) {
+	ospSet1i(renderer, "spp", spp);
+	ospCommit(renderer);
+	for (int frames = 0; frames < numFrames.x; frames++) {
+	  ospRenderFrame(sfb, renderer, OSP_FB_COLOR);
+	}
+	auto tf = ospray::impi::Time();
+	for (int frames = 0; frames < numFrames.y; frames++) {
+	  ospRenderFrame(sfb, renderer, OSP_FB_COLOR);
+	}
+	const double frame = 
+	  numFrames.y > 0 ? ospray::impi::Time(tf) / numFrames.y : 0.0;
+	const double rays = double(size.x) * size.y * spp;
+	std::cout << "#osp:bench: " << size.x << " " << size.y << " " << spp 
+		  << " " << rays * 1e-6 << " " << frame << " " 
+		  << 1e9 * frame / rays << std::endl;
+	tb.Row({(double)size.x, (double)size.y, (double)spp, rays, frame,
+		1e9 * frame / rays});
+	xs.push_back(rays);
+	ys.push_back(frame);
+      }
+      ospFreeFrameBuffer(sfb);
+    }
+    double fixed, perRay, r2;
+    if (ospray::impi::LinearFit(xs, ys, fixed, perRay, r2)) {
+      std::cout << "#osp:bench: " << name << " fit: " << fixed 
+		<< "s per frame + " << 1e9 * perRay << "ns per ray (r^2 "
+		<< r2 << ")" << std::endl;
+      report.Set(name, "fixedTime", fixed);
+      report.Set(name, "rayTime", perRay);
+      report.Set(name, "r2", r2);
+    }
+    ospSet1f(camera, "aspect", imgSize.x / (float)imgSize.y);
+    ospCommit(camera);
+    ospSet1i(renderer, "spp", 1);
+    ospCommit(renderer);
+  };
+  if (!fbSweep.empty()) {
+    RaySweep("fbSweep", fbSweep, {1});
+  }
+  if (!sppSweep.empty()) {
+    RaySweep("sppSweep", {imgSize}, sppSweep);
+  }
+
+  // batch mode: all jobs share the loaded volume, every distinct set of
+  // iso-values is extracted once, and the images are written by a
+  // thread of their own while the next job renders
+  if (!jobsName.empty()) {
+    const auto jobs = ospray::impi::LoadJobs(jobsName, imgSize);
+    std::cout << "#osp:bench: " << jobs.size() << " jobs from " << jobsName
+	      << std::endl;
+    std::vector<float> defaultIsos;
+    for (const auto& v : isoValues) defaultIsos.push_back(v.v);
+    std::map<std::vector<float>, OSPModel> worlds;
+    auto JobWorld = [&](const std::vector<float>& isos, double& buildTime) {
+      buildTime = 0.0;
+      const auto found = worlds.find(isos);
+      if (found != worlds.end()) return found->second;
+      OSPModel model = world; // already built for the command line
+      if (isos != defaultIsos) {
+	model = ospNewModel();
+	if (showVolume) {
+	  ospAddVolume(model, volume);
+	}
+	if (isoMode == NORMAL) {
+	  // the same builtin geometry as the command line world
+	  OSPMaterial m = ospNewMaterial(renderer, "OBJMaterial");
+	  ospSetVec3f(m, "Kd", osp::vec3f{1.0f, 1.0f, 1.0f});
+	  ospSetVec3f(m, "Ks", osp::vec3f{0.1f, 0.1f, 0.1f});
+	  ospSet1f(m, "Ns", 10.f);
+	  ospCommit(m);
+	  OSPGeometry g = ospNewGeometry("isosurfaces");
+	  OSPData values = ospNewData(isos.size(), OSP_FLOAT, isos.data());
+	  ospSetData(g, "isovalues", values);
+	  ospSetObject(g, "volume", volume);
+	  ospSetMaterial(g, m);
+	  ospCommit(g);
+	  ospAddGeometry(model, g);
+	  ospRelease(values);
+	  ospRelease(g);
+	  ospRelease(m);
+	}
+	for (size_t i = 0; isoMode == IMPI && i < isos.size(); ++i) {
+	  OSPMaterial m = 
+	    NewIsoMaterial(isoValues[std::min(i, isoValues.size() - 1)].c);
+	  OSPGeometry g = NewIsoGeometry(isos[i], m, "");
+	  ospAddGeometry(model, g);
+	  ospRelease(g);
+	  ospRelease(m);
+	}
+	if (showObject) {
+	  mesh.AddToModel(model, renderer, mtlobj);
+	}
+	buildTime = CommitModel(model).commitTime;
+      }
+      worlds[isos] = model;
+      return model;
+    };
+    auto& tb = report.AddTable("jobs", {"job", "width", "height", "spp",
+					"buildTime", "renderTime"});
+    std::cout << "#osp:bench: job name width height spp build(s) render(s)"
+	      << std::endl;
+    const int jobChannels = OSP_FB_COLOR | OSP_FB_ACCUM;
+    OSPFrameBuffer jobFb = nullptr;
+    vec2i jobFbSize(0);
+    ospray::impi::ImageWriter writer;
+    auto tJobs = ospray::impi::Time();
+    for (size_t j = 0; j < jobs.size(); ++j) {
+      const auto& job = jobs[j];
+      double buildTime = 0.0;
+      OSPModel model = 
+	JobWorld(job.isos.empty() ? defaultIsos : job.isos, buildTime);
+      if (job.size != jobFbSize) {
+	if (jobFb) ospFreeFrameBuffer(jobFb);
+	jobFb = ospNewFrameBuffer((const osp::vec2i&)job.size, 
+				  OSP_FB_SRGBA, jobChannels);
+	jobFbSize = job.size;
+      }
+      ospFrameBufferClear(jobFb, jobChannels);
+      ospSet1f(camera, "aspect", job.size.x / (float)job.size.y);
+      SetView(job.hasView ? job.view : ospray::impi::CameraKey{vp, vi, vu});
+      ospSet1i(renderer, "spp", job.spp);
+      ospSetObject(renderer, "model", model);
+      ospCommit(renderer);
+      double renderTime = 0.0;
+      {
+	ospray::impi::TraceScope trace("job");
+	auto tf = ospray::impi::Time();
+	ospRenderFrame(jobFb, renderer, jobChannels);
+	renderTime = ospray::impi::Time(tf);
+      }
+      const uint32_t* buffer = 
+	(const uint32_t*)ospMapFrameBuffer(jobFb, OSP_FB_COLOR);
+      writer.Push(outputImageName + "_" + job.name + ".ppm",
+		  job.size.x, job.size.y, buffer);
+      ospUnmapFrameBuffer(buffer, jobFb);
+      std::cout << "#osp:bench: " << j << " " << job.name << " " 
+		<< job.size.x << " " << job.size.y << " " << job.spp << " "
+		<< buildTime << " " << renderTime << std::endl;
+      tb.Row({(double)j, (double)job.size.x, (double)job.size.y, 
+	      (double)job.spp, buildTime, renderTime});
+    }
+    writer.Finish();
+    const double jobsTime = ospray::impi::Time(tJobs);
+    std::cout << "#osp:bench: " << jobs.size() << " jobs with " 
+	      << worlds.size() << " iso-value set(s) took " << jobsTime 
+	      << "s" << std::endl;
+    report.Phase("jobs", jobsTime);
+    // back to the command line setup
+    if (jobFb) ospFreeFrameBuffer(jobFb);
+    for (auto& w : worlds) {
+      if (w.second != world) ospRelease(w.second);
+    }
+    ospSet1f(camera, "aspect", imgSize.x / (float)imgSize.y);
+    SetView(ospray::impi::CameraKey{vp, vi, vu});
+    ospSet1i(renderer, "spp", 1);
+    ospSetObject(renderer, "model", world);
+    ospCommit(renderer);
+  }
+  ospRelease(smtl);
+
+  // write report, it is also what the baseline is compared against
+  if ((!reportName.empty() || !baselineName.empty()) && mpiRank == 0) {
+    report.Set("config", "input", timeSteps[0]);
+    report.Set("config", "timeSteps", (double)timeSteps.size());
+    report.Set("config", "voxelSource", inputVolume->Kind());
+    report.Set("config", "attribute", attributeName);
+    report.Set("config", "dataParallelRanks", dataParallel ? mpiSize : 0.0);
+    report.Set("config", "renderer", rendererName);
+    report.Set("config", "isoMode", isoMode == IMPI ? "impi" : "builtin");
+    report.Set("config", "width",  (double)imgSize.x);
+    report.Set("config", "height", (double)imgSize.y);
+    report.Set("config", "warmupFrames",  (double)numFrames.x);
+    report.Set("config", "measureFrames", (double)numFrames.y);
+    report.Set("config", "cameraPath", 
+               cameraOrbit ? "orbit" : cameraPathName);
+    if (!jobsName.empty()) {
+      report.Set("config", "jobs", jobsName);
+    }
+    if (isoSweepSteps > 0) {
+      report.Set("config", "isoSweepMin", isoSweepRange.x);
+      report.Set("config", "isoSweepMax", isoSweepRange.y);
+      report.Set("config", "isoSweepSteps", (double)isoSweepSteps);
+    }
+    for (size_t i = 0; i < isoValues.size(); ++i) {
+      report.Set("config", "isoValue" + std::to_string(i), isoValues[i].v);
+    }
+    for (auto env : {"IMPI_AMR_METHOD", "IMPI_AMR_STORAGE"}) {
+      const char* v = getenv(env);
+      report.Set("config", env, v ? v : "");
+    }
+    report.HostInfo(ActiveThreads());
+
+    // extraction and bvh build are only known if the module is local
+    double extractTime = 0.0, finalizeTime = 0.0;
+    for (const auto& s : impiStats) {
+      extractTime  += s.extractTime;
+      finalizeTime += s.finalizeTime;
+    }
+    report.Phase("load",         inputVolume->loadTime);
+    report.Phase("convert",      inputVolume->convertTime);
+    report.Phase("volumeCreate", createTime);
+    report.Phase("modelCommit",  commitTime);
+    if (ospray::impi::HasModuleStats()) {
+      report.Phase("extraction", extractTime);
+      report.Phase("bvhBuild",   std::max(commitTime - finalizeTime, 0.0));
+    }
+    double warmupTotal = 0.0;
+    for (auto x : warmupTimes) warmupTotal += x;
+    report.Phase("warmup",  warmupTotal);
+    report.Phase("measure", et);
+    report.Frames("warmup",   warmupTimes);
+    report.Frames("measured", frameTimes);
+    auto& tb = report.AddTable("impi", {"isoValue", "activeVoxels",
+                                        "extractTime", "finalizeTime",
+                                        "sourceBytes", "refBytes",
+                                        "stagingBytes"});
+    for (const auto& s : impiStats) {
+      tb.Row({s.isoValue, (double)s.numActiveVoxels,
+              s.extractTime, s.finalizeTime, (double)s.sourceBytes,
+              (double)s.refBytes, (double)s.stagingBytes});
+    }
+    for (const auto& m : phaseMemory) {
+      report.Set("memory", "peakRss." + m.first, (double)m.second);
+    }
+    if (dataParallel) {
+      report.Set("dataParallel", "ranks",          (double)mpiSize);
+      report.Set("dataParallel", "bricks",         dpBricks);
+      report.Set("dataParallel", "activeVoxels",   dpActive);
+      report.Set("dataParallel", "slowestCommit",  dpCommitMax);
+      report.Set("dataParallel", "slowestExtract", dpExtractMax);
+    }
+    if (hasEmbreeMemory) {
+      report.Set("memory", "embreeBytes",     (double)embreeBytes);
+      report.Set("memory", "embreePeakBytes", (double)embreePeakBytes);
+    }
+    if (usePath) {
+      auto& tp = report.AddTable("path", {"frame", "time",
+                                          "vp.x", "vp.y", "vp.z",
+                                          "vi.x", "vi.y", "vi.z"});
+      for (size_t i = 0; i < views.size(); ++i) {
+        const auto& k = views[i];
+        tp.Row({(double)i, frameTimes[i], 
+                k.vp.x, k.vp.y, k.vp.z, k.vi.x, k.vi.y, k.vi.z});
+      }
+    }
+    if (!baselineName.empty()) {
+      ospray::impi::Baseline baseline;
+      baseline.Load(baselineName);
+      std::cout << "#osp:bench: comparing against baseline " << baselineName
+		<< " (tolerance " << 100.f * baselineTolerance << "%, "
+		<< baselineMinSeconds << "s)" << std::endl;
+      const int regressions = ospray::impi::Baseline::Print(
+        baseline.Compare(report.Timings(), baselineTolerance,
+			 baselineMinSeconds));
+      report.Set("baseline", "file", baselineName);
+      report.Set("baseline", "tolerance", baselineTolerance);
+      report.Set("baseline", "minSeconds", baselineMinSeconds);
+      report.Set("baseline", "regressions", (double)regressions);
+      if (regressions > 0) {
+	std::cout << "#osp:bench: " << regressions 
+		  << " timing(s) regressed against the baseline" << std::endl;
+	exitCode = 3;
+      }
+    }
+    if (!reportName.empty()) {
+      report.Write(reportName);
+    }
+  }
 
 #endif
 
   // done
   std::cout << "#osp:bench: done benchmarking" << std::endl;
-  return 0;
+  return exitCode;
 }
@@ -0,0 +1,147 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include "ospcommon/vec.h"
+#include "ospcommon/box.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    //! one camera pose, same convention as -vp/-vi/-vu
+    struct CameraKey
+    {
+      ospcommon::vec3f vp, vi, vu;
+    };
+
+    // ==================================================================== //
+    // A camera path sampled at a fixed number of frames. Keyframes are
+    // read from a text file with one pose per line
+    //
+    //     vp.x vp.y vp.z  vi.x vi.y vi.z  vu.x vu.y vu.z
+    //
+    // ('#' starts a comment) and interpolated with a Catmull-Rom spline
+    // through the keyframes, so that the camera passes every keyframe.
+    // ==================================================================== //
+    class CameraPath {
+    private:
+      std::vector<CameraKey> keys;
+      //! the last key is a copy of the first one, see Frame
+      bool closed{false};
+
+      static ospcommon::vec3f CatmullRom(const ospcommon::vec3f& p0,
+                                         const ospcommon::vec3f& p1,
+                                         const ospcommon::vec3f& p2,
+                                         const ospcommon::vec3f& p3,
+                                         const float t)
+      {
+        const float t2 = t * t, t3 = t2 * t;
+        return 0.5f * ((2.f * p1) +
+                       (p2 - p0) * t +
+                       (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+                       (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+      }
+
+    public:
+      size_t NumKeys() const { return keys.size(); }
+      const CameraKey& Key(size_t i) const { return keys[i]; }
+      void Add(const CameraKey& k) { keys.push_back(k); }
+
+      static CameraPath Load(const std::string& fileName)
+      {
+        std::ifstream is(fileName);
+        if (!is) {
+          throw std::runtime_error("cannot open camera path " + fileName);
+        }
+        CameraPath path;
+        std::string line;
+        for (int n = 1; std::getline(is, line); ++n) {
+          line = line.substr(0, line.find('#'));
+          if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+          std::istringstream ls(line);
+          CameraKey k;
+          if (!(ls >> k.vp.x >> k.vp.y >> k.vp.z
+                   >> k.vi.x >> k.vi.y >> k.vi.z
+                   >> k.vu.x >> k.vu.y >> k.vu.z)) {
+            throw std::runtime_error(fileName + ":" + std::to_string(n) +
+                                     ": expected 9 values (vp vi vu)");
+          }
+          path.Add(k);
+        }
+        if (path.keys.empty()) {
+          throw std::runtime_error("no keyframes in camera path " + fileName);
+        }
+        return path;
+      }
+
+      //! a full circle around 'bounds' in the plane orthogonal to 'up',
+      //! slightly above the center and far enough away to see everything
+      //! with the bench's 60 degree field of view
+      static CameraPath Orbit(const ospcommon::box3f& bounds,
+                              const ospcommon::vec3f& up,
+                              const int numKeys = 36)
+      {
+        using namespace ospcommon;
+        const vec3f center = bounds.center();
+        const float radius = 0.5f * length(bounds.size());
+        const float dist = radius / std::sin(0.5f * float(M_PI) / 3.f);
+        const vec3f w = normalize(up);
+        vec3f u = cross(w, std::abs(w.x) < 0.9f ? vec3f(1,0,0) : vec3f(0,1,0));
+        u = normalize(u);
+        const vec3f v = cross(w, u);
+        CameraPath path;
+        for (int i = 0; i < numKeys; ++i) {
+          const float a = 2.f * float(M_PI) * i / numKeys;
+          CameraKey k;
+          k.vp = center + dist * (std::cos(a) * u + std::sin(a) * v) +
+            0.25f * dist * w;
+          k.vi = center;
+          k.vu = w;
+          path.Add(k);
+        }
+        // close the loop so that sampling ends where it started
+        path.Add(path.keys.front());
+        path.closed = true;
+        return path;
+      }
+
+      //! pose at t in [0,1] along the path
+      CameraKey Sample(float t) const
+      {
+        const int n = (int)keys.size();
+        if (n == 1) return keys[0];
+        t = std::min(std::max(t, 0.f), 1.f) * (n - 1);
+        const int i = std::min((int)t, n - 2);
+        const float f = t - i;
+        const auto& k0 = keys[std::max(i - 1, 0)];
+        const auto& k1 = keys[i];
+        const auto& k2 = keys[i + 1];
+        const auto& k3 = keys[std::min(i + 2, n - 1)];
+        CameraKey k;
+        k.vp = CatmullRom(k0.vp, k1.vp, k2.vp, k3.vp, f);
+        k.vi = CatmullRom(k0.vi, k1.vi, k2.vi, k3.vi, f);
+        k.vu = normalize(k1.vu * (1.f - f) + k2.vu * f);
+        return k;
+      }
+
+      //! pose of frame 'i' out of 'numFrames' uniformly spaced samples,
+      //! a closed path stops one step short of its start so that no
+      //! view is rendered twice
+      CameraKey Frame(const int i, const int numFrames) const
+      {
+        if (closed) return Sample(i / float(std::max(numFrames, 1)));
+        return Sample(numFrames > 1 ? i / float(numFrames - 1) : 0.f);
+      }
+    };
+
+  };
+};
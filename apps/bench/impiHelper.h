@@ -12,6 +12,9 @@
 #else
 #  include <alloca.h>
 #endif
+#ifdef __unix__
+#  include <unistd.h>
+#endif
 #include <chrono>
 #include <sstream>
 #include <type_traits>
@@ -54,16 +57,60 @@ namespace ospray {
 
     // timer
     typedef std::chrono::high_resolution_clock::time_point time_point;
-    time_point Time() {
+    inline time_point Time() {
       return std::chrono::high_resolution_clock::now();
     }
-    double Time(const time_point& t1) {
+    inline double Time(const time_point& t1) {
       time_point t2 = std::chrono::high_resolution_clock::now();
       std::chrono::duration<double> et = 
 	std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1);
       return et.count();  
     }
 
+    // resident set size of this process in bytes (0 if unknown)
+    inline size_t ResidentMemory() {
+      size_t pages = 0, resident = 0;
+#ifdef __unix__
+      FILE *file = fopen("/proc/self/statm", "r");
+      if (file) {
+	if (fscanf(file, "%zu %zu", &pages, &resident) != 2) resident = 0;
+	fclose(file);
+      }
+      return resident * (size_t)sysconf(_SC_PAGESIZE);
+#else
+      return 0;
+#endif
+    }
+
+    // peak resident set size (VmHWM) of this process in bytes
+    inline size_t PeakResidentMemory() {
+      size_t peak = 0;
+#ifdef __unix__
+      FILE *file = fopen("/proc/self/status", "r");
+      if (file) {
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+	  if (sscanf(line, "VmHWM: %zu kB", &peak) == 1) { peak *= 1024; break; }
+	}
+	fclose(file);
+      }
+#endif
+      return peak;
+    }
+    // restart the peak resident set size at the current size, so that
+    // the peak of the next phase can be measured (linux >= 4.0), returns
+    // false if the peak could not be reset and keeps growing since start
+    inline bool ResetPeakResidentMemory() {
+#ifdef __unix__
+      FILE *file = fopen("/proc/self/clear_refs", "w");
+      if (file) {
+	const bool ok = fputs("5", file) >= 0;
+	return (fclose(file) == 0) && ok;
+      }
+#endif
+      return false;
+    }
+
     template <class T1, class T2> T1 lexical_cast(const T2& t2) {
       std::stringstream s; s << t2; T1 t1;
       if(s >> t1 && s.eof()) { return t1; }
@@ -82,6 +129,7 @@ namespace ospray {
       } else {
 	throw std::runtime_error("value required for " + std::string(av[init]));
       }
+      return v;
     }
     template<int N, typename T> T Parse(const int ac, const char** av, int &i, T& v) {
       const int init = i;
@@ -92,14 +140,15 @@ namespace ospray {
       } else {
 	throw std::runtime_error(std::to_string(N) + " values required for " + av[init]);
       }
+      return v;
     }
-    template<> int Parse<1, int>(const int ac, const char** av, int &i, int& v) {
+    template<> inline int Parse<1, int>(const int ac, const char** av, int &i, int& v) {
       return ParseScalar<int>(ac, av, i, v);
     }
-    template<> float Parse<1, float>(const int ac, const char** av, int &i, float& v) {
+    template<> inline float Parse<1, float>(const int ac, const char** av, int &i, float& v) {
       return ParseScalar<float>(ac, av, i, v);
     }
-    template<> double Parse<1, double>(const int ac, const char** av, int &i, double& v) {
+    template<> inline double Parse<1, double>(const int ac, const char** av, int &i, double& v) {
       return ParseScalar<double>(ac, av, i, v);
     }
 
@@ -0,0 +1,114 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    //! an RGBA8 image in framebuffer order (first row is the bottom)
+    struct Image
+    {
+      int width{0}, height{0};
+      std::vector<uint32_t> pixels;
+    };
+
+    //! read a binary (P6) PPM, e.g. one written by writePPM. rows are
+    //! flipped back, so that the result can be compared to a mapped
+    //! framebuffer directly
+    inline Image ReadPPM(const std::string& fileName)
+    {
+      std::ifstream is(fileName, std::ios::binary);
+      if (!is) {
+	throw std::runtime_error("cannot open image " + fileName);
+      }
+      // header: magic, width, height, maxval, with optional comments
+      auto token = [&]() {
+	std::string t;
+	while (is >> t && t[0] == '#') {
+	  is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+	}
+	return t;
+      };
+      Image img;
+      int maxval = 0;
+      if (token() != "P6") {
+	throw std::runtime_error(fileName + " is not a binary PPM (P6)");
+      }
+      img.width  = std::atoi(token().c_str());
+      img.height = std::atoi(token().c_str());
+      maxval     = std::atoi(token().c_str());
+      if (img.width <= 0 || img.height <= 0 || maxval != 255) {
+	throw std::runtime_error(fileName + ": unsupported PPM header");
+      }
+      is.get(); // single whitespace before the pixel data
+      std::vector<unsigned char> row(3 * img.width);
+      img.pixels.resize(size_t(img.width) * img.height);
+      for (int y = 0; y < img.height; ++y) {
+	if (!is.read((char*)row.data(), row.size())) {
+	  throw std::runtime_error(fileName + ": truncated pixel data");
+	}
+	uint32_t* out = &img.pixels[size_t(img.height - 1 - y) * img.width];
+	for (int x = 0; x < img.width; ++x) {
+	  out[x] = uint32_t(row[3 * x + 0])
+	    | (uint32_t(row[3 * x + 1]) << 8)
+	    | (uint32_t(row[3 * x + 2]) << 16)
+	    | 0xff000000u;
+	}
+      }
+      return img;
+    }
+
+    struct ImageDiff
+    {
+      double rmse{0.0};  //!< over all RGB channels, in [0,255]
+      double psnr{std::numeric_limits<double>::infinity()}; //!< in dB
+      size_t differing{0}; //!< pixels with any channel off by > threshold
+    };
+
+    //! compare the RGB channels of two images of the same size
+    inline ImageDiff CompareImages(const Image& a, const Image& b,
+				   const int threshold = 2)
+    {
+      if (a.width != b.width || a.height != b.height) {
+	throw std::runtime_error("cannot compare images of different size (" +
+				 std::to_string(a.width) + "x" +
+				 std::to_string(a.height) + " vs " +
+				 std::to_string(b.width) + "x" +
+				 std::to_string(b.height) + ")");
+      }
+      ImageDiff d;
+      double sse = 0.0;
+      for (size_t i = 0; i < a.pixels.size(); ++i) {
+	int maxDiff = 0;
+	for (int c = 0; c < 3; ++c) {
+	  const int va = (a.pixels[i] >> (8 * c)) & 0xff;
+	  const int vb = (b.pixels[i] >> (8 * c)) & 0xff;
+	  const int e = std::abs(va - vb);
+	  sse += double(e) * e;
+	  maxDiff = std::max(maxDiff, e);
+	}
+	if (maxDiff > threshold) ++d.differing;
+      }
+      if (!a.pixels.empty()) {
+	d.rmse = std::sqrt(sse / (3.0 * a.pixels.size()));
+      }
+      if (d.rmse > 0.0) {
+	d.psnr = 20.0 * std::log10(255.0 / d.rmse);
+      }
+      return d;
+    }
+
+  };
+};
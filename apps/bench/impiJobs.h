@@ -0,0 +1,166 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include "impiCameraPath.h"
+#include "impiHelper.h"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    //! one image of a batch run
+    struct Job
+    {
+      std::string name;        //!< output is <-o>_<name>.ppm
+      bool hasView{false};     //!< false: the view of -vp/-vi/-vu
+      CameraKey view;
+      std::vector<float> isos; //!< empty: the iso-values of -isos
+      ospcommon::vec2i size;
+      int spp{1};
+    };
+
+    // ==================================================================== //
+    // A batch of images read from a text file with one job per line
+    //
+    //     name  camera  iso-values  width height  spp
+    //
+    // ('#' starts a comment). 'camera' is a camera path file (see
+    // impiCameraPath.h) whose first keyframe is used, or 'file:k' for
+    // keyframe k. 'iso-values' is a comma separated list. Either can be
+    // '-' for what the command line says, and so can width and height.
+    // ==================================================================== //
+    inline std::vector<Job> LoadJobs(const std::string& fileName,
+                                     const ospcommon::vec2i& defaultSize)
+    {
+      std::ifstream is(fileName);
+      if (!is) {
+        throw std::runtime_error("cannot open job file " + fileName);
+      }
+      std::vector<Job> jobs;
+      std::string line;
+      for (int n = 1; std::getline(is, line); ++n) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        const std::string where = fileName + ":" + std::to_string(n) + ": ";
+        std::istringstream ls(line);
+        std::string camera, isos, w, h;
+        Job job;
+        if (!(ls >> job.name >> camera >> isos >> w >> h >> job.spp)) {
+          throw std::runtime_error(where + "expected 6 values "
+                                   "(name camera iso-values width height spp)");
+        }
+        if (camera != "-") {
+          size_t key = 0;
+          const auto colon = camera.find_last_of(':');
+          if (colon != std::string::npos && colon + 1 < camera.size() &&
+              camera.find_first_not_of("0123456789", colon + 1) ==
+              std::string::npos) {
+            key    = std::stoul(camera.substr(colon + 1));
+            camera = camera.substr(0, colon);
+          }
+          const auto path = CameraPath::Load(camera);
+          if (key >= path.NumKeys()) {
+            throw std::runtime_error(where + "no keyframe " +
+                                     std::to_string(key) + " in " + camera);
+          }
+          job.view = path.Key(key);
+          job.hasView = true;
+        }
+        if (isos != "-") {
+          std::istringstream vs(isos);
+          std::string v;
+          while (std::getline(vs, v, ',')) {
+            job.isos.push_back(std::stof(v));
+          }
+        }
+        job.size.x = w == "-" ? defaultSize.x : std::stoi(w);
+        job.size.y = h == "-" ? defaultSize.y : std::stoi(h);
+        if (job.size.x <= 0 || job.size.y <= 0 || job.spp < 1) {
+          throw std::runtime_error(where + "invalid size or spp");
+        }
+        jobs.push_back(job);
+      }
+      if (jobs.empty()) {
+        throw std::runtime_error("no jobs in " + fileName);
+      }
+      return jobs;
+    }
+
+    // ==================================================================== //
+    // Writes images on a thread of its own, so that encoding and writing
+    // one image overlaps rendering the next. Push blocks while
+    // 'maxPending' images are waiting, which bounds the memory held.
+    // ==================================================================== //
+    class ImageWriter {
+    private:
+      struct Image {
+        std::string fileName;
+        size_t width, height;
+        std::vector<uint32_t> pixels;
+      };
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<Image> queue;
+      size_t maxPending;
+      bool done{false};
+      std::thread worker;
+
+      void Run()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          changed.wait(lock, [&]() { return done || !queue.empty(); });
+          if (queue.empty()) return; // done
+          Image img = std::move(queue.front());
+          queue.pop_front();
+          changed.notify_all();
+          lock.unlock();
+          writePPM(img.fileName, img.width, img.height, img.pixels.data());
+          lock.lock();
+        }
+      }
+
+    public:
+      explicit ImageWriter(const size_t maxPending = 4)
+        : maxPending(maxPending), worker([this]() { Run(); })
+      {
+      }
+      ~ImageWriter() { Finish(); }
+
+      //! queue a copy of 'pixels' (framebuffer order, see writePPM)
+      void Push(const std::string& fileName, const size_t width,
+                const size_t height, const uint32_t* pixels)
+      {
+        Image img{fileName, width, height,
+                  std::vector<uint32_t>(pixels, pixels + width * height)};
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return queue.size() < maxPending; });
+        queue.push_back(std::move(img));
+        changed.notify_all();
+      }
+
+      //! write everything queued and stop the thread
+      void Finish()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          done = true;
+        }
+        changed.notify_all();
+        if (worker.joinable()) worker.join();
+      }
+    };
+
+  };
+};
@@ -0,0 +1,99 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+// the application must not link against the module, so everything the
+// module reports is looked up by symbol name in the libraries ospray
+// has loaded (see ospray/common/ImpiStats.h)
+#include "../../ospray/common/ImpiStats.h"
+#include "../../ospray/common/ImpiTrace.h"
+#include "ospcommon/library.h"
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    //! resolve a function exported by the impi module, nullptr if the
+    //! module does not live in this address space (e.g. --osp:mpi)
+    template<typename F> F ModuleFunction(const char* name)
+    {
+      return (F)ospcommon::getSymbol(name);
+    }
+
+    //! true if the per-finalize records of the module can be read
+    inline bool HasModuleStats()
+    {
+      return ModuleFunction<ImpiStatsCountFcn>(IMPI_STATS_COUNT_FCN) &&
+        ModuleFunction<ImpiStatsGetFcn>(IMPI_STATS_GET_FCN);
+    }
+
+    //! all records since the last ClearModuleStats()
+    inline std::vector<ImpiStats> GetModuleStats()
+    {
+      std::vector<ImpiStats> ret;
+      auto count = ModuleFunction<ImpiStatsCountFcn>(IMPI_STATS_COUNT_FCN);
+      auto get   = ModuleFunction<ImpiStatsGetFcn>(IMPI_STATS_GET_FCN);
+      if (count && get) {
+        ret.resize(count());
+        for (size_t i = 0; i < ret.size(); ++i) {
+          if (!get(i, &ret[i])) { ret.resize(i); break; }
+        }
+      }
+      return ret;
+    }
+
+    inline void ClearModuleStats()
+    {
+      auto clear = ModuleFunction<ImpiStatsClearFcn>(IMPI_STATS_CLEAR_FCN);
+      if (clear) clear();
+    }
+
+    //! bytes embree has allocated now and at peak, false if unknown
+    inline bool EmbreeMemory(int64_t& current, int64_t& peak,
+                             const bool resetPeak = false)
+    {
+      auto get = ModuleFunction<ImpiEmbreeMemoryFcn>(IMPI_EMBREE_MEMORY_FCN);
+      current = peak = 0;
+      if (!get) return false;
+      get(&current, &peak, resetPeak ? 1 : 0);
+      return true;
+    }
+
+    //! leaves extracted so far of the geometry being finalized right
+    //! now, false if unknown. safe to call while another thread commits
+    inline bool ExtractProgress(uint64_t& done, uint64_t& total)
+    {
+      auto get = ModuleFunction<ImpiProgressFcn>(IMPI_PROGRESS_FCN);
+      done = total = 0;
+      if (!get) return false;
+      get(&done, &total);
+      return true;
+    }
+
+    //! an event on the module's trace timeline (see IMPI_TRACE) for
+    //! the lifetime of this object, does nothing if tracing is off
+    class TraceScope {
+      ImpiTraceNowFcn now{nullptr};
+      ImpiTraceEventFcn event{nullptr};
+      const char* name;
+      int64_t begin{0};
+    public:
+      explicit TraceScope(const char* name) : name(name)
+      {
+        auto enabled = ModuleFunction<ImpiTraceEnabledFcn>(IMPI_TRACE_ENABLED_FCN);
+        if (enabled && enabled()) {
+          now   = ModuleFunction<ImpiTraceNowFcn>(IMPI_TRACE_NOW_FCN);
+          event = ModuleFunction<ImpiTraceEventFcn>(IMPI_TRACE_EVENT_FCN);
+          if (now) begin = now();
+        }
+      }
+      ~TraceScope()
+      {
+        if (now && event) event(name, "bench", begin, now());
+      }
+    };
+
+  };
+};
@@ -3,17 +3,31 @@
 // ======================================================================== //
 
 #include "impiReader.h"
+#include "impiHelper.h"
 #include "ospcommon/FileName.h"
 #include "common/sg/common/Common.h"
 #include "hdf5.h"
+#include <cstdio>
+#include <cstdlib>
 #include <map>
 
 namespace ospray {
 
   namespace ParseOSP {
 
-    std::shared_ptr<ospray::amr::AMRVolume> loadOSP(const std::string &fileName)
+    std::shared_ptr<ospray::VolumeNode> loadOSP(const std::string &fileName,
+                                                const Partition &partition,
+                                                const std::string &attribute)
     {
+      const auto t = ospray::impi::Time();
+      if (FileName(fileName).ext() == "hdf5") {
+        // a bare Chombo file, e.g. one timestep of a series
+        auto volume = std::make_shared<ospray::amr::AMRVolume>();
+        volume->partition = partition;
+        volume->attributeName = attribute;
+        volume->LoadChombo(fileName, "", nullptr);
+        return volume;
+      }
       std::shared_ptr<xml::XMLDoc> doc = xml::readXML(fileName);
       assert(doc);
       if (!doc) {
@@ -36,15 +50,33 @@ namespace ospray {
         if (child.name == "AMRVolume") {	  
           auto volume = std::make_shared<ospray::amr::AMRVolume>();
           std::cout << "#osp:amr: start parsing OSP file" << std::endl;
+          volume->loadTime = ospray::impi::Time(t);
+          volume->partition = partition;
+          volume->attributeName = attribute;
           volume->Load(child);
           std::cout << "#osp:amr: done parsing OSP file" << std::endl;
           return volume;	  
         }     
+        else if (child.name == "StructuredVolume" ||
+                 child.name == "SegmentedVolume") {
+          if (partition.size > 1) {
+            throw std::runtime_error("only AMR volumes can be loaded "
+                                     "data-parallel");
+          }
+          if (!attribute.empty()) {
+            throw std::runtime_error("only AMR volumes can be coloured "
+                                     "by an attribute");
+          }
+          auto volume = std::make_shared<ospray::structured::StructuredVolume>();
+          volume->Load(child, child.name == "SegmentedVolume");
+          volume->loadTime = ospray::impi::Time(t) - volume->convertTime;
+          return volume;
+        }
         else {
           std::cout << "#osp:amr: skip node " + child.name << std::endl;
         }   
       }   
-      throw std::runtime_error("AMR volume not found");
+      throw std::runtime_error("no AMR, structured or segmented volume found");
       return nullptr;      
     }
 
@@ -327,6 +359,28 @@ namespace ospray {
       return bounds;
     }
 
+    //! region 'rank' of 'size' of 'bounds', see ospray::Partition
+    static box3f SplitBounds(box3f bounds, int rank, int size)
+    {
+      while (size > 1) {
+        const vec3f extent = bounds.size();
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+                       : extent.y >= extent.z ? 1 : 2;
+        const int lower = size / 2;
+        const float split = bounds.lower[axis] + 
+          extent[axis] * float(lower) / float(size);
+        if (rank < lower) {
+          bounds.upper[axis] = split;
+          size = lower;
+        } else {
+          bounds.lower[axis] = split;
+          rank -= lower;
+          size -= lower;
+        }
+      }
+      return bounds;
+    }
+
     //! parse Chombo hdf5 file into AMRVolume node
     void parseAMRChomboFile(ospray::amr::AMRVolume* volume,
                             const FileName &fileName,
@@ -334,7 +388,10 @@ namespace ospray {
                             const range1f *clampRange,
                             int maxLevel)
     {
+      auto t = ospray::impi::Time();
       AMR *amr = AMR::parse(fileName.str(), maxLevel);
+      volume->loadTime += ospray::impi::Time(t);
+      t = ospray::impi::Time();
       if (amr->level.empty()) {
 	throw std::runtime_error("empty AMR volume");
       }
@@ -345,6 +402,17 @@ namespace ospray {
       assert(rootLevelBounds.lower == vec3i(0));
 
       volume->bounds = amr->getWorldBounds();
+      const Partition &part = volume->partition;
+      if (part.size > 1) {
+        // the octant reconstruction of a voxel reads the cells around
+        // its corners, two coarse cells of ghost shell cover it
+        volume->region = SplitBounds(volume->bounds, part.rank, part.size);
+        const float ghost = 2.f * float(amr->level[0]->dt);
+        volume->ghostRegion = box3f(volume->region.lower - vec3f(ghost),
+                                    volume->region.upper + vec3f(ghost));
+        std::cout << "#osp:amr: rank " << part.rank << "/" << part.size
+                  << " owns " << volume->region << std::endl;
+      }
 
       volume->componentID = -1;
       for (size_t i = 0; i < amr->component.size(); i++) {
@@ -361,11 +429,29 @@ namespace ospray {
           throw std::runtime_error("could not find desird component '" +
                                    desiredComponent + "'");
       }
+      volume->attributeID = -1;
+      if (!volume->attributeName.empty()) {
+        for (size_t i = 0; i < amr->component.size(); i++) {
+          if (amr->component[i] == volume->attributeName) {
+            volume->attributeID = i;
+          }
+        }
+        if (volume->attributeID < 0)
+          throw std::runtime_error("could not find attribute component '" +
+                                   volume->attributeName + "'");
+        std::cout << "#osp:amr: colouring by component '"
+                  << volume->attributeName << "'" << std::endl;
+      }
       for (size_t levelID = 0; levelID < amr->level.size(); levelID++) {
         Level *level = amr->level[levelID];
 	std::cout << "#osp:amr: - level: " << levelID << " : " << level->boxes.size()
 		  << " boxes" << std::endl;
         for (size_t brickID = 0; brickID < level->boxes.size(); brickID++) {
+          if (part.size > 1 &&
+              !touchingOrOverlapping(volume->ghostRegion,
+                                     level->getWorldBounds(brickID))) {
+            continue;
+          }
 	  ospray::amr::AMRVolume::BrickInfo bi;
           bi.box   = level->boxes[brickID];
           bi.dt    = level->dt;
@@ -386,9 +472,23 @@ namespace ospray {
                 volume->valueRange.extend(v);
                 *f++ = v;
               }
+          if (volume->attributeID >= 0) {
+            // same cells, the attribute is never clamped
+            float *a = new float[numValues];
+            volume->attributePtrs.push_back(a);
+            for (int iz = 0; iz < bi.size().z; iz++)
+              for (int iy = 0; iy < bi.size().y; iy++)
+                for (int ix = 0; ix < bi.size().x; ix++) {
+                  const double v = level->getValue(brickID, volume->attributeID,
+                                                   vec3i(ix, iy, iz));
+                  volume->attributeRange.extend(v);
+                  *a++ = v;
+                }
+          }
         }
         level->data.clear();
       }
+      volume->convertTime += ospray::impi::Time(t);
       std::cout << "#osp:amr: found " << volume->brickInfo.size() << " bricks"<< std::endl;
     }
 
@@ -410,18 +510,12 @@ namespace ospray {
       }
       if (fileName != "") {
         std::string compName = node.getProp("component"); 
+        if (attributeName.empty())
+          attributeName = node.getProp("attribute");
 	std::cout << "#osp:amr:" << compName << std::endl;;
         FileName realFN = node.doc->fileName.path() + fileName;
-        if (realFN.ext() == "hdf5") {
-	ospray:ParseAMR::parseAMRChomboFile(this,
-					    realFN,
-					    compName,
-					    clampRangeString.empty() ? nullptr : &clampRange,
-					    maxLevel);
-	  this->voxelRange = this->valueRange.toVec2f();
-        } else {
-    	  throw std::runtime_error("non hdf5 file");
-    	}        
+        LoadChombo(realFN, compName,
+		   clampRangeString.empty() ? nullptr : &clampRange);
       } else {
         throw std::runtime_error("no filename");
       }
@@ -435,6 +529,137 @@ namespace ospray {
 
     }
 
+    void AMRVolume::LoadChombo(const FileName &fileName,
+                               const std::string &component,
+                               const range1f *clampRange) {
+      if (fileName.ext() == "hdf5") {
+	ospray::ParseAMR::parseAMRChomboFile(this,
+					     fileName,
+					     component,
+					     clampRange,
+					     maxLevel);
+	this->voxelRange = this->valueRange.toVec2f();
+      } else {
+	throw std::runtime_error("non hdf5 file");
+      }        
+    }
+
   }; // ::ospray::amr
 
+  namespace structured {
+
+    //! read 'dims' floats from a raw file
+    static void ReadRAW(std::vector<float> &values, const std::string &fileName,
+                        const vec3i &dims)
+    {
+      values.resize(size_t(dims.x) * dims.y * dims.z);
+      FILE *file = fopen(fileName.c_str(), "rb");
+      if (!file) {
+        throw std::runtime_error("cannot open " + fileName);
+      }
+      const size_t n = fread(values.data(), sizeof(float), values.size(), file);
+      fclose(file);
+      if (n != values.size()) {
+        throw std::runtime_error(fileName + " holds " + std::to_string(n) +
+                                 " floats, expected " +
+                                 std::to_string(values.size()));
+      }
+    }
+
+    void StructuredVolume::Load(const xml::Node &node, const bool segmented) {
+
+      const std::string fileName = node.getProp("fileName");
+      if (fileName.empty()) {
+        throw std::runtime_error("no filename");
+      }
+      const std::string voxelType = node.getProp("voxelType");
+      if (!voxelType.empty() && voxelType != "float") {
+        throw std::runtime_error("voxelType '" + voxelType +
+                                 "' is not supported, only float");
+      }
+      if (sscanf(node.getProp("dimensions").c_str(), "%i %i %i",
+                 &dims.x, &dims.y, &dims.z) != 3 || reduce_min(dims) < 2) {
+        throw std::runtime_error("missing or invalid dimensions of " + fileName);
+      }
+      // the unit cube, unless the file says otherwise
+      gridSpacing = rcp(vec3f(dims) - vec3f(1.f));
+      const std::string origin = node.getProp("gridOrigin");
+      if (!origin.empty()) {
+        sscanf(origin.c_str(), "%f %f %f",
+               &gridOrigin.x, &gridOrigin.y, &gridOrigin.z);
+      }
+      const std::string spacing = node.getProp("gridSpacing");
+      if (!spacing.empty()) {
+        sscanf(spacing.c_str(), "%f %f %f",
+               &gridSpacing.x, &gridSpacing.y, &gridSpacing.z);
+      }
+      bounds = box3f(gridOrigin,
+                     gridOrigin + gridSpacing * (vec3f(dims) - vec3f(1.f)));
+
+      const std::string path = node.doc->fileName.path();
+      std::cout << "#osp:structured: " << fileName << " " << dims << std::endl;
+      ReadRAW(voxels, path + fileName, dims);
+      if (segmented) {
+        const std::string segFileName = node.getProp("segmentFileName");
+        if (segFileName.empty()) {
+          throw std::runtime_error("SegmentedVolume needs a segmentFileName");
+        }
+        segment = std::atoi(node.getProp("segment").c_str());
+        ReadRAW(segments, path + segFileName, dims);
+        std::cout << "#osp:structured: segment " << segment << " of "
+                  << segFileName << std::endl;
+      }
+
+      const auto t = ospray::impi::Time();
+      range1f valueRange;
+      for (const float v : voxels) valueRange.extend(v);
+      voxelRange = valueRange.toVec2f();
+      convertTime = ospray::impi::Time(t);
+    }
+
+    OSPVolume StructuredVolume::Create(OSPTransferFunction tfn) {
+
+      volume = ospNewVolume("shared_structured_volume");
+      ospVoxelData = ospNewData(voxels.size(), OSP_FLOAT, voxels.data(),
+                                OSP_DATA_SHARED_BUFFER);
+      ospCommit(ospVoxelData);
+      if (!segments.empty()) {
+        ospSegmentData = ospNewData(segments.size(), OSP_FLOAT,
+                                    segments.data(), OSP_DATA_SHARED_BUFFER);
+        ospCommit(ospSegmentData);
+      }
+
+      ospSetData(volume, "voxelData", ospVoxelData);
+      ospSetString(volume, "voxelType", "float");
+      ospSetVec3i(volume, "dimensions", (const osp::vec3i&)dims);
+      ospSetVec3f(volume, "gridOrigin", (const osp::vec3f&)gridOrigin);
+      ospSetVec3f(volume, "gridSpacing", (const osp::vec3f&)gridSpacing);
+
+      ospSetObject(volume, "transferFunction", tfn);
+      ospSetVec2f(volume, "voxelRange", (const osp::vec2f&)voxelRange);
+      ospSet1i(volume, "gradientShadingEnabled", 0);
+      ospSet1i(volume, "preIntegration", 0);
+      ospSet1i(volume, "singleShade", 0);
+      ospSet1i(volume, "adaptiveSampling", 0);
+      ospSet1f(volume, "samplingRate", 1.f);
+
+      ospCommit(volume);
+      return volume;
+    }
+
+    void StructuredVolume::SetImpiParams(OSPGeometry geo, OSPVolume) const {
+      // the geometry shares the voxel values of the ospray volume
+      ospSetString(geo, "voxelSource", Kind());
+      ospSetData(geo, "voxelData", ospVoxelData);
+      ospSetVec3i(geo, "dimensions", (const osp::vec3i&)dims);
+      ospSetVec3f(geo, "gridOrigin", (const osp::vec3f&)gridOrigin);
+      ospSetVec3f(geo, "gridSpacing", (const osp::vec3f&)gridSpacing);
+      if (!segments.empty()) {
+        ospSetData(geo, "segmentData", ospSegmentData);
+        ospSet1i(geo, "segment", segment);
+      }
+    }
+
+  }; // ::ospray::structured
+
 }  // ::ospray
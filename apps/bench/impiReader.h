@@ -12,6 +12,7 @@
 #include "ospcommon/range.h"
 #include "ospcommon/AffineSpace.h"
 #include "ospcommon/xml/XML.h"
+#include "ospcommon/FileName.h"
 #include <vector>
 #include <string>
 
@@ -19,29 +20,92 @@ using namespace ospcommon;
 
 namespace ospray {
 
+  //! which part of a volume a rank of a data-parallel run loads: the
+  //! bounds are split into 'size' regions by recursive bisection along
+  //! the longest axis, and rank 'rank' keeps the bricks overlapping its
+  //! region grown by a ghost shell
+  struct Partition
+  {
+    int rank{0};
+    int size{1};
+  };
+
+  //! a volume read from an .osp file, which can create the ospray
+  //! volume to render and hand itself to impi geometries
+  struct VolumeNode
+  {
+    virtual ~VolumeNode() {}
+
+    const ospcommon::vec2f& Range() const { return voxelRange; };
+    //! "amr", "structured" or "segmented", the impi voxelSource
+    virtual const char* Kind() const = 0;
+    virtual OSPVolume Create(OSPTransferFunction tfn) = 0;
+    //! set the impi parameters that select this volume as the voxel
+    //! source, 'volume' is what Create returned
+    virtual void SetImpiParams(OSPGeometry geo, OSPVolume volume) const = 0;
+
+    ospcommon::vec2f voxelRange; // the copy of value range, which will be updated in Load
+    ospcommon::box3f bounds;
+
+    // wall-clock seconds spent reading the xml and data files, and
+    // converting them into what ospray takes
+    double loadTime{0.0};
+    double convertTime{0.0};
+  };
+
   namespace amr {
 
     //! AMR SG node with Chombo style structure
-    struct AMRVolume
+    struct AMRVolume : public VolumeNode
     {
       AMRVolume() : maxLevel(1 << 30), amrMethod("current") {}
       ~AMRVolume() {
 	for (auto *ptr : brickPtrs) {
 	  delete [] ptr;
 	}
+	for (auto *ptr : attributePtrs) {
+	  delete [] ptr;
+	}
 	for (auto& obj : brickData) {
 	  ospRelease(obj);
 	}
+	for (auto& obj : attributeData) {
+	  ospRelease(obj);
+	}
 	if (volume != nullptr) {
 	  ospRelease(volume);
 	  ospRelease(ospBrickData);
 	  ospRelease(ospBrickInfo);
 	}
+	if (attributeVolume != nullptr) {
+	  ospRelease(attributeVolume);
+	  ospRelease(ospAttributeData);
+	  ospRelease(attributeTfn);
+	}
       };
 
-      const ospcommon::vec2f& Range() const { return voxelRange; };
       void Load(const xml::Node &node);
-      OSPVolume Create(OSPTransferFunction tfn) {
+      //! read a Chombo hdf5 file, 'component' empty: the first one
+      void LoadChombo(const ospcommon::FileName &fileName,
+		      const std::string &component,
+		      const ospcommon::range1f *clampRange);
+      const char* Kind() const override { return "amr"; }
+      void SetImpiParams(OSPGeometry geo, OSPVolume volume) const override {
+	ospSetObject(geo, "amrDataPtr", volume);
+	if (!region.empty()) {
+	  // voxels outside the region are another rank's
+	  OSPData clip = ospNewData(2, OSP_FLOAT3, &region);
+	  ospCommit(clip);
+	  ospSetData(geo, "clipBoxes", clip);
+	  ospRelease(clip);
+	}
+	if (attributeVolume != nullptr) {
+	  // colour the surface by the secondary component
+	  ospSetObject(geo, "attributeDataPtr", attributeVolume);
+	  ospSetObject(geo, "attributeTransferFunction", attributeTfn);
+	}
+      }
+      OSPVolume Create(OSPTransferFunction tfn) override {
 
 	volume = ospNewVolume("amr_volume");
 
@@ -77,10 +141,57 @@ namespace ospray {
 	ospSet1f(volume, "samplingRate", 1.f);
 
 	ospCommit(volume);
+
+	if (!attributePtrs.empty()) {
+	  CreateAttribute();
+	}
 	return volume;
 
       }
 
+      //! the amr volume of the attribute component over the same
+      //! bricks, and a blue to red transfer function over its range
+      void CreateAttribute() {
+	for (size_t bID = 0; bID < brickInfo.size(); bID++) {
+	  const auto &bi = brickInfo[bID];
+	  OSPData data = ospNewData(bi.size().product(),
+				    OSP_FLOAT,
+				    this->attributePtrs[bID],
+				    OSP_DATA_SHARED_BUFFER);
+	  this->attributeData.push_back(data);
+	}
+	ospAttributeData = ospNewData(attributeData.size(),
+				      OSP_DATA,
+				      (OSPObject*)(attributeData.data()),
+				      OSP_DATA_SHARED_BUFFER);
+
+	const float colors[] = {0.f, 0.f, 1.f,
+				0.f, 1.f, 1.f,
+				0.f, 1.f, 0.f,
+				1.f, 1.f, 0.f,
+				1.f, 0.f, 0.f};
+	const float opacities[] = {1.f, 1.f};
+	OSPData colorsData = ospNewData(5, OSP_FLOAT3, colors);
+	OSPData opacitiesData = ospNewData(2, OSP_FLOAT, opacities);
+	attributeTfn = ospNewTransferFunction("piecewise_linear");
+	ospSetData(attributeTfn, "colors", colorsData);
+	ospSetData(attributeTfn, "opacities", opacitiesData);
+	ospSetVec2f(attributeTfn, "valueRange",
+		    (const osp::vec2f&)attributeRange.toVec2f());
+	ospCommit(attributeTfn);
+	ospRelease(colorsData);
+	ospRelease(opacitiesData);
+
+	attributeVolume = ospNewVolume("amr_volume");
+	ospSetData(attributeVolume, "brickData", ospAttributeData);
+	ospSetData(attributeVolume, "brickInfo", ospBrickInfo);
+	ospSetString(attributeVolume, "voxelType", "float");
+	ospSetObject(attributeVolume, "transferFunction", attributeTfn);
+	ospSetVec2f(attributeVolume, "voxelRange",
+		    (const osp::vec2f&)attributeRange.toVec2f());
+	ospCommit(attributeVolume);
+      }
+
       // ------------------------------------------------------------------
       // this is the way we're passing over the data. for each input
       // box we create one data array (for the data values), and one
@@ -111,11 +222,24 @@ namespace ospray {
       // ID of the data component we want to render (each brick can
       // contain multiple components)
       int componentID{0};
+      // optional second component that colours the iso-surfaces (set
+      // before Load, or the 'attribute' property of the node)
+      std::string attributeName;
+      int attributeID{-1};
+      ospcommon::range1f attributeRange;
+      std::vector<float *> attributePtrs;
+      std::vector<OSPData> attributeData;
+      OSPData ospAttributeData = nullptr;
+      OSPVolume attributeVolume = nullptr;
+      OSPTransferFunction attributeTfn = nullptr;
       int maxLevel;
-      ospcommon::vec2f voxelRange; // the copy of value range, which will be updated in Load
       ospcommon::range1f valueRange;
-      ospcommon::box3f bounds;
       std::string amrMethod;
+      // data-parallel: what to load (set before Load), the region this
+      // rank owns and the one its bricks were loaded for (empty: all)
+      Partition partition;
+      ospcommon::box3f region;
+      ospcommon::box3f ghostRegion;
       std::vector<OSPData> brickData;
       std::vector<BrickInfo> brickInfo;
       std::vector<float *> brickPtrs;
@@ -124,8 +248,49 @@ namespace ospray {
 
   };
 
+  namespace structured {
+
+    //! SG node for a regular grid of float vertex values read from a
+    //! raw file, optionally with a second grid of segment ids of which
+    //! only 'segment' gets an iso-surface (SegmentedVolume node)
+    struct StructuredVolume : public VolumeNode
+    {
+      ~StructuredVolume() {
+	if (volume != nullptr) {
+	  ospRelease(volume);
+	  ospRelease(ospVoxelData);
+	  if (ospSegmentData) ospRelease(ospSegmentData);
+	}
+      }
+
+      void Load(const xml::Node &node, const bool segmented);
+      const char* Kind() const override {
+	return segments.empty() ? "structured" : "segmented";
+      }
+      void SetImpiParams(OSPGeometry geo, OSPVolume) const override;
+      OSPVolume Create(OSPTransferFunction tfn) override;
+
+      OSPVolume volume = nullptr;
+      OSPData ospVoxelData = nullptr;
+      OSPData ospSegmentData = nullptr;
+
+      ospcommon::vec3i dims;
+      ospcommon::vec3f gridOrigin{0.f};
+      ospcommon::vec3f gridSpacing{1.f};
+      std::vector<float> voxels;
+      std::vector<float> segments; // empty: not segmented
+      int segment{0};
+    };
+
+  };
+
   namespace ParseOSP {
-    std::shared_ptr<ospray::amr::AMRVolume> loadOSP(const std::string &fileName);
+    //! the first AMRVolume, StructuredVolume or SegmentedVolume node,
+    //! or a Chombo .hdf5 file. only AMR volumes can be partitioned or
+    //! coloured by a second 'attribute' component
+    std::shared_ptr<ospray::VolumeNode> loadOSP(const std::string &fileName,
+                                                const Partition &partition = Partition(),
+                                                const std::string &attribute = "");
   };
   
 };
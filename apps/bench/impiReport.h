@@ -0,0 +1,353 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __unix__
+# include <unistd.h>
+#endif
+
+namespace ospray {
+  namespace impi {
+
+    //! p-th percentile (p in [0,100]) of a sample set, linearly
+    //! interpolated between the two closest ranks
+    inline double Percentile(std::vector<double> v, const double p)
+    {
+      if (v.empty()) return 0.0;
+      std::sort(v.begin(), v.end());
+      const double r = std::min(std::max(p, 0.0), 100.0) / 100.0 * (v.size() - 1);
+      const size_t i = (size_t)std::floor(r);
+      const size_t j = std::min(i + 1, v.size() - 1);
+      return v[i] + (r - i) * (v[j] - v[i]);
+    }
+
+    inline double Mean(const std::vector<double>& v)
+    {
+      if (v.empty()) return 0.0;
+      double s = 0.0;
+      for (auto x : v) s += x;
+      return s / v.size();
+    }
+
+    //! least squares fit of y = a + b * x, 'r2' is the coefficient of
+    //! determination. false if there are less than two distinct x
+    inline bool LinearFit(const std::vector<double>& x,
+                          const std::vector<double>& y,
+                          double& a, double& b, double& r2)
+    {
+      a = b = r2 = 0.0;
+      const size_t n = std::min(x.size(), y.size());
+      if (n < 2) return false;
+      double mx = 0.0, my = 0.0;
+      for (size_t i = 0; i < n; ++i) { mx += x[i]; my += y[i]; }
+      mx /= n;
+      my /= n;
+      double sxx = 0.0, sxy = 0.0, syy = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        sxx += (x[i] - mx) * (x[i] - mx);
+        sxy += (x[i] - mx) * (y[i] - my);
+        syy += (y[i] - my) * (y[i] - my);
+      }
+      if (sxx <= 0.0) return false;
+      b  = sxy / sxx;
+      a  = my - b * mx;
+      r2 = syy > 0.0 ? sxy * sxy / (sxx * syy) : 1.0;
+      return true;
+    }
+
+    // ==================================================================== //
+    // Machine readable benchmark report. Everything is kept in insertion
+    // order so that successive runs produce diffable files. The format is
+    // picked from the file extension: '.csv' writes one flat
+    // "section,name,value" table, anything else writes JSON.
+    // ==================================================================== //
+    class Report {
+    public:
+      //! a named table with fixed columns, e.g. one row per frame
+      struct Table {
+        std::string name;
+        std::vector<std::string> columns;
+        std::vector<std::vector<double>> rows;
+        void Row(const std::vector<double>& r) { rows.push_back(r); }
+      };
+
+    private:
+      // (key, already encoded json literal)
+      typedef std::vector<std::pair<std::string, std::string>> Fields;
+      std::vector<std::pair<std::string, Fields>> sections;
+      std::vector<std::pair<std::string, std::vector<double>>> series;
+      std::vector<Table> tables;
+
+    public:
+      static std::string Quote(const std::string& s)
+      {
+        std::string r = "\"";
+        for (const char c : s) {
+          switch (c) {
+          case '"':  r += "\\\""; break;
+          case '\\': r += "\\\\"; break;
+          case '\n': r += "\\n";  break;
+          case '\t': r += "\\t";  break;
+          default:
+            if ((unsigned char)c < 0x20) continue;
+            r += c;
+          }
+        }
+        return r + "\"";
+      }
+      static std::string Number(const double v)
+      {
+        if (!std::isfinite(v)) return "null";
+        std::ostringstream s;
+        s << std::setprecision(9) << v;
+        return s.str();
+      }
+
+      //! set a key in a section, sections and keys are created on demand
+      void Set(const std::string& section, const std::string& key,
+               const std::string& value)
+      {
+        Put(section, key, Quote(value));
+      }
+      void Set(const std::string& section, const std::string& key,
+               const char* value)
+      {
+        Put(section, key, Quote(value));
+      }
+      void Set(const std::string& section, const std::string& key,
+               const double value)
+      {
+        Put(section, key, Number(value));
+      }
+      //! timing of a build/load phase in seconds
+      void Phase(const std::string& name, const double seconds)
+      {
+        Set("phases", name, seconds);
+      }
+      //! a series of frame times in seconds, summarized on output
+      void Frames(const std::string& name, const std::vector<double>& t)
+      {
+        for (auto& s : series) {
+          if (s.first == name) { s.second = t; return; }
+        }
+        series.emplace_back(name, t);
+      }
+      //! all phases and the mean and percentiles of every frame series
+      //! as flat "phases.<name>" and "frames.<name>.<stat>" keys, the
+      //! timings a later run can be compared against (see Baseline)
+      std::vector<std::pair<std::string, double>> Timings() const
+      {
+        std::vector<std::pair<std::string, double>> t;
+        for (const auto& s : sections) {
+          if (s.first != "phases") continue;
+          for (const auto& f : s.second) {
+            t.emplace_back("phases." + f.first, std::atof(f.second.c_str()));
+          }
+        }
+        for (const auto& s : series) {
+          if (s.second.empty()) continue;
+          for (const auto& f : Summary(s.second)) {
+            if (f.first == "mean" || f.first == "p50" || f.first == "p90") {
+              t.emplace_back("frames." + s.first + "." + f.first,
+                             std::atof(f.second.c_str()));
+            }
+          }
+        }
+        return t;
+      }
+      Table& AddTable(const std::string& name,
+                      const std::vector<std::string>& columns)
+      {
+        tables.emplace_back();
+        tables.back().name = name;
+        tables.back().columns = columns;
+        return tables.back();
+      }
+
+      //! hostname, cpu model and thread counts
+      void HostInfo(const int ospThreads)
+      {
+#ifdef __unix__
+        char hname[256] = {0};
+        gethostname(hname, sizeof(hname) - 1);
+        Set("host", "name", std::string(hname));
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+          if (line.compare(0, 10, "model name") == 0) {
+            const auto p = line.find(':');
+            if (p != std::string::npos) {
+              Set("host", "cpu", line.substr(std::min(p + 2, line.size())));
+            }
+            break;
+          }
+        }
+#endif
+        Set("host", "hardwareThreads",
+            (double)std::thread::hardware_concurrency());
+        Set("host", "ospThreads", (double)ospThreads);
+      }
+
+      bool Write(const std::string& fileName) const
+      {
+        std::ofstream os(fileName);
+        if (!os) {
+          std::cerr << "#osp:bench: cannot write report " << fileName
+                    << std::endl;
+          return false;
+        }
+        const auto dot = fileName.find_last_of('.');
+        const bool csv = dot != std::string::npos &&
+          fileName.substr(dot) == ".csv";
+        if (csv) WriteCSV(os); else WriteJSON(os);
+        std::cout << "#osp:bench: wrote report " << fileName << std::endl;
+        return true;
+      }
+
+    private:
+      void Put(const std::string& section, const std::string& key,
+               const std::string& value)
+      {
+        auto s = std::find_if(sections.begin(), sections.end(),
+                              [&](const std::pair<std::string, Fields>& p)
+                              { return p.first == section; });
+        if (s == sections.end()) {
+          sections.emplace_back(section, Fields());
+          s = sections.end() - 1;
+        }
+        for (auto& f : s->second) {
+          if (f.first == key) { f.second = value; return; }
+        }
+        s->second.emplace_back(key, value);
+      }
+      static Fields Summary(const std::vector<double>& t)
+      {
+        double total = 0.0;
+        for (auto x : t) total += x;
+        Fields f;
+        f.emplace_back("count", Number(t.size()));
+        f.emplace_back("total", Number(total));
+        f.emplace_back("mean",  Number(Mean(t)));
+        f.emplace_back("fps",   Number(total > 0.0 ? t.size() / total : 0.0));
+        f.emplace_back("min",   Number(Percentile(t, 0)));
+        f.emplace_back("p50",   Number(Percentile(t, 50)));
+        f.emplace_back("p90",   Number(Percentile(t, 90)));
+        f.emplace_back("p99",   Number(Percentile(t, 99)));
+        f.emplace_back("max",   Number(Percentile(t, 100)));
+        return f;
+      }
+      static void WriteFields(std::ostream& os, const Fields& f,
+                              const std::string& indent)
+      {
+        for (size_t i = 0; i < f.size(); ++i) {
+          os << indent << Quote(f[i].first) << ": " << f[i].second
+             << (i + 1 < f.size() ? "," : "") << "\n";
+        }
+      }
+      void WriteJSON(std::ostream& os) const
+      {
+        os << "{\n";
+        bool first = true;
+        for (const auto& s : sections) {
+          os << (first ? "" : ",\n") << "  " << Quote(s.first) << ": {\n";
+          WriteFields(os, s.second, "    ");
+          os << "  }";
+          first = false;
+        }
+        os << (first ? "" : ",\n") << "  \"frames\": {";
+        for (size_t k = 0; k < series.size(); ++k) {
+          const auto& t = series[k].second;
+          os << (k ? ",\n" : "\n") << "    " << Quote(series[k].first)
+             << ": {\n";
+          std::string times = "[";
+          for (size_t i = 0; i < t.size(); ++i) {
+            times += (i ? ", " : "") + Number(t[i]);
+          }
+          auto f = Summary(t);
+          f.emplace_back("times", times + "]");
+          WriteFields(os, f, "      ");
+          os << "    }";
+        }
+        os << (series.empty() ? "}" : "\n  }");
+        os << ",\n  \"tables\": {";
+        for (size_t k = 0; k < tables.size(); ++k) {
+          const auto& tb = tables[k];
+          os << (k ? ",\n" : "\n") << "    " << Quote(tb.name)
+             << ": {\n      \"columns\": [";
+          for (size_t i = 0; i < tb.columns.size(); ++i) {
+            os << (i ? ", " : "") << Quote(tb.columns[i]);
+          }
+          os << "],\n      \"rows\": [";
+          for (size_t r = 0; r < tb.rows.size(); ++r) {
+            os << (r ? ",\n        [" : "\n        [");
+            for (size_t i = 0; i < tb.rows[r].size(); ++i) {
+              os << (i ? ", " : "") << Number(tb.rows[r][i]);
+            }
+            os << "]";
+          }
+          os << (tb.rows.empty() ? "]" : "\n      ]") << "\n    }";
+        }
+        os << (tables.empty() ? "}" : "\n  }") << "\n}\n";
+      }
+      static std::string CSVValue(const std::string& json)
+      {
+        // strings are quoted the same way in json and csv, except
+        // that csv doubles embedded quotes
+        if (json.empty() || json[0] != '"') return json;
+        std::string r;
+        for (size_t i = 1; i + 1 < json.size(); ++i) {
+          if (json[i] == '\\' && i + 2 < json.size()) {
+            ++i;
+            r += json[i] == '"' ? "\"\"" : std::string(1, json[i]);
+          } else {
+            r += json[i];
+          }
+        }
+        return "\"" + r + "\"";
+      }
+      void WriteCSV(std::ostream& os) const
+      {
+        os << "section,name,value\n";
+        for (const auto& s : sections) {
+          for (const auto& f : s.second) {
+            os << s.first << "," << f.first << "," << CSVValue(f.second)
+               << "\n";
+          }
+        }
+        for (const auto& s : series) {
+          for (const auto& f : Summary(s.second)) {
+            os << "frames." << s.first << "," << f.first << ","
+               << f.second << "\n";
+          }
+          for (size_t i = 0; i < s.second.size(); ++i) {
+            os << "frames." << s.first << "," << i << ","
+               << Number(s.second[i]) << "\n";
+          }
+        }
+        for (const auto& tb : tables) {
+          for (size_t r = 0; r < tb.rows.size(); ++r) {
+            for (size_t i = 0; i < tb.columns.size() && i < tb.rows[r].size();
+                 ++i) {
+              os << "tables." << tb.name << "," << r << "." << tb.columns[i]
+                 << "," << Number(tb.rows[r][i]) << "\n";
+            }
+          }
+        }
+      }
+    };
+
+  };
+};
@@ -0,0 +1,104 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+
+    inline bool FileExists(const std::string& fileName)
+    {
+      std::ifstream is(fileName);
+      return is.good();
+    }
+
+    //! true if 'pattern' holds exactly one integer conversion %d, %4d
+    //! or %04d (and maybe %%), the only ones snprintf may expand in it
+    inline bool IsIndexPattern(const std::string& pattern)
+    {
+      int conversions = 0;
+      for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') continue;
+        if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+          ++i;
+          continue;
+        }
+        size_t j = i + 1;
+        while (j < pattern.size() && isdigit((unsigned char)pattern[j])) ++j;
+        if (j == pattern.size() || pattern[j] != 'd') return false;
+        ++conversions;
+        i = j;
+      }
+      return conversions == 1;
+    }
+
+    // ==================================================================== //
+    // The files of a time series, one timestep each, from the input files
+    // of the command line. Every input is one of
+    //
+    //     step_0042.osp      a single .osp or Chombo .hdf5 file
+    //     step_%04d.hdf5     a printf pattern, expanded with 0, 1, 2, ...
+    //                        (or 1, 2, ... if there is no 0) until the
+    //                        first missing file
+    //     steps.txt          a list with one file per line, relative
+    //                        to the list ('#' starts a comment)
+    //
+    // ==================================================================== //
+    inline std::vector<std::string>
+    ExpandTimeSeries(const std::vector<std::string>& inputs)
+    {
+      std::vector<std::string> files;
+      for (const auto& in : inputs) {
+        const auto dot = in.find_last_of('.');
+        const std::string ext = dot == std::string::npos ? "" : in.substr(dot);
+        if (in.find('%') != std::string::npos) {
+          if (!IsIndexPattern(in)) {
+            throw std::runtime_error("time series pattern " + in + " must "
+                                     "hold exactly one %d (e.g. %04d)");
+          }
+          const size_t first = files.size();
+          char name[4096];
+          for (int t = 0; ; ++t) {
+            snprintf(name, sizeof(name), in.c_str(), t);
+            if (FileExists(name)) {
+              files.push_back(name);
+            } else if (t > 0 || files.size() > first) {
+              break;
+            }
+          }
+          if (files.size() == first) {
+            throw std::runtime_error("no files match " + in);
+          }
+        } else if (ext == ".txt") {
+          std::ifstream is(in);
+          if (!is) {
+            throw std::runtime_error("cannot open time series list " + in);
+          }
+          const auto slash = in.find_last_of('/');
+          const std::string path =
+            slash == std::string::npos ? "" : in.substr(0, slash + 1);
+          std::string line;
+          while (std::getline(is, line)) {
+            line = line.substr(0, line.find('#'));
+            const auto b = line.find_first_not_of(" \t\r");
+            if (b == std::string::npos) continue;
+            line = line.substr(b, line.find_last_not_of(" \t\r") + 1 - b);
+            files.push_back(line[0] == '/' ? line : path + line);
+          }
+        } else {
+          files.push_back(in);
+        }
+      }
+      return files;
+    }
+
+  };
+};
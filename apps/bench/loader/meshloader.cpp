@@ -1,8 +1,19 @@
 #define TINYOBJLOADER_IMPLEMENTATION  // define this in only *one* .cc
 
 #include "meshloader.h"
+#include "ospcommon/tasking/parallel_for.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <limits>
 #include <set>
+#include <unordered_map>
+#include <sys/stat.h>
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
 
 void WarnAlways(std::string str)
 {
@@ -71,11 +82,18 @@ void Mesh::SetTransform(const affine3f &xfm)
   transform = affine3f(xfm);
 }
 
-bool Mesh::LoadFromFileObj(const char *filename, bool loadMtl)
+bool Mesh::LoadFromFileObj(const char *filename, bool loadMtl, bool useCache)
 {
   // initialize
   tiny.Clear();
+  cache.reset();
   ComputePath(filename);
+  const char *env = getenv("IMPI_MESH_CACHE");
+  useCache = useCache && !loadMtl && !(env && std::string(env) == "0");
+  const std::string cacheFile = fpath + ".cache";
+  if (useCache && LoadCache(cacheFile)) {
+    return true;
+  }
 
   // load mesh from file using tiny obj loader
   bool succeed = tinyobj::LoadObj(&(tiny.attributes),
@@ -91,87 +109,343 @@ bool Mesh::LoadFromFileObj(const char *filename, bool loadMtl)
   if (!succeed) {
     return false;
   }
+  if (!BuildGeometries()) {
+    return false;
+  }
+  if (useCache) {
+    WriteCache(cacheFile);
+  }
+  return true;
+}
 
-  // initialize bounding box
-  bbox.upper = vec3f(std::numeric_limits<float>::min());
-  bbox.lower = vec3f(std::numeric_limits<float>::max());
+namespace {
+  //! one vertex of a face, as tiny obj loader indexes it
+  struct FaceVertex {
+    int v, n, t;
+    bool operator==(const FaceVertex &o) const
+    {
+      return v == o.v && n == o.n && t == o.t;
+    }
+  };
+  struct FaceVertexHash {
+    size_t operator()(const FaceVertex &k) const
+    {
+      size_t h = std::hash<int>()(k.v);
+      h ^= std::hash<int>()(k.n) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      h ^= std::hash<int>()(k.t) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+};
 
+bool Mesh::BuildGeometries()
+{
   // initialize geometries array
+  geometries.clear();
   geometries.resize(tiny.shapes.size());
+  std::vector<box3f> bounds(tiny.shapes.size(), box3f(empty));
+  std::vector<char>  triangular(tiny.shapes.size(), 1);
+  std::vector<size_t> corners(tiny.shapes.size(), 0);
 
-  // process geometry
-  for (size_t s = 0; s < tiny.shapes.size(); s++)  // Loop over shapes
-  {
+  // process geometry, shapes are independent of each other
+  tasking::parallel_for(tiny.shapes.size(), [&](size_t s) {
     Geometry &geo = geometries[s];
+    const tinyobj::mesh_t &mesh = tiny.shapes[s].mesh;
     // note: it seems tiny obj loader uses per-face material
     //       but we need only one material per geometry
     //       so we use the first face for material index
-    geo.num_faces = tiny.shapes[s].mesh.num_face_vertices.size();
-    if (geo.num_faces <= 0) {
-      WarnAlways("shape #" + std::to_string(s) +
-                 "found one shape with no faces");
+    geo.num_faces = mesh.num_face_vertices.size();
+    for (const auto fv : mesh.num_face_vertices) {
+      if (fv != 3) { triangular[s] = 0; return; }
     }
-
-    size_t vidx_offset = 0;
-    for (size_t f = 0; f < geo.num_faces; f++)  // Loop over faces (polygon)
-    {
-      // number of vertices of this face
-      int fv = tiny.shapes[s].mesh.num_face_vertices[f];
-      if (fv != 3) {
-        ErrorNoExit("this mesh is not a pure trianglar mesh");
-        return false;
+    // a vertex is shared by faces if all its indices are the same
+    std::unordered_map<FaceVertex, unsigned int, FaceVertexHash> unique;
+    unique.reserve(mesh.indices.size() / 2);
+    geo.index.storage.reserve(mesh.indices.size());
+    for (const tinyobj::index_t &idx : mesh.indices) {
+      const FaceVertex key{idx.vertex_index, 
+                           idx.normal_index, 
+                           idx.texcoord_index};
+      const auto found = unique.find(key);
+      if (found != unique.end()) {
+        geo.index.storage.push_back(found->second);
+        continue;
       }
-
-      // Loop over vertices in the face.
-      for (size_t v = 0; v < fv /*fv=3*/; v++) {
-        tinyobj::index_t idx = tiny.shapes[s].mesh.indices[vidx_offset + v];
+      const unsigned int id = unique.size();
+      unique.emplace(key, id);
+      geo.index.storage.push_back(id);
 // WILL NOTE: HACK TO TRANSFORM LANDING GEAR: -translate 15.995 16 0.1
 #if 1
-        float vx = tiny.attributes.vertices[3 * idx.vertex_index + 0] + 15.995;
-        float vy = tiny.attributes.vertices[3 * idx.vertex_index + 1] + 16;
-        float vz = tiny.attributes.vertices[3 * idx.vertex_index + 2] + 0.1;
+      float vx = tiny.attributes.vertices[3 * idx.vertex_index + 0] + 15.995;
+      float vy = tiny.attributes.vertices[3 * idx.vertex_index + 1] + 16;
+      float vz = tiny.attributes.vertices[3 * idx.vertex_index + 2] + 0.1;
 #else
-        float vx = tiny.attributes.vertices[3 * idx.vertex_index + 0];
-        float vy = tiny.attributes.vertices[3 * idx.vertex_index + 1];
-        float vz = tiny.attributes.vertices[3 * idx.vertex_index + 2];
+      float vx = tiny.attributes.vertices[3 * idx.vertex_index + 0];
+      float vy = tiny.attributes.vertices[3 * idx.vertex_index + 1];
+      float vz = tiny.attributes.vertices[3 * idx.vertex_index + 2];
 #endif
-        geo.index.push_back(geo.index.size());
-        geo.vertex.push_back(vx);
-        geo.vertex.push_back(vy);
-        geo.vertex.push_back(vz);
-        bbox.upper = max(bbox.upper, vec3f(vx, vy, vz));
-        bbox.lower = min(bbox.lower, vec3f(vx, vy, vz));
-        // check normal
-        if (idx.normal_index >= 0) {
-          geo.has_normal = true;
-          float nx       = tiny.attributes.normals[3 * idx.normal_index + 0];
-          float ny       = tiny.attributes.normals[3 * idx.normal_index + 1];
-          float nz       = tiny.attributes.normals[3 * idx.normal_index + 2];
-          geo.normal.push_back(nx);
-          geo.normal.push_back(ny);
-          geo.normal.push_back(nz);
-        } else {
-          WarnOnce("normal not found");
-        }
-        // check texture coordinate
-        if (idx.texcoord_index >= 0) {
-          geo.has_texcoord = true;
-          float tx = tiny.attributes.texcoords[2 * idx.texcoord_index + 0];
-          float ty = tiny.attributes.texcoords[2 * idx.texcoord_index + 1];
-          geo.texcoord.push_back(tx);
-          geo.texcoord.push_back(ty);
-        } else {
-          WarnOnce("texture coordinate not found");
-        }
+      geo.vertex.storage.push_back(vx);
+      geo.vertex.storage.push_back(vy);
+      geo.vertex.storage.push_back(vz);
+      bounds[s].extend(vec3f(vx, vy, vz));
+      // check normal
+      if (idx.normal_index >= 0) {
+        geo.has_normal = true;
+        float nx       = tiny.attributes.normals[3 * idx.normal_index + 0];
+        float ny       = tiny.attributes.normals[3 * idx.normal_index + 1];
+        float nz       = tiny.attributes.normals[3 * idx.normal_index + 2];
+        geo.normal.storage.push_back(nx);
+        geo.normal.storage.push_back(ny);
+        geo.normal.storage.push_back(nz);
+      }
+      // check texture coordinate
+      if (idx.texcoord_index >= 0) {
+        geo.has_texcoord = true;
+        float tx = tiny.attributes.texcoords[2 * idx.texcoord_index + 0];
+        float ty = tiny.attributes.texcoords[2 * idx.texcoord_index + 1];
+        geo.texcoord.storage.push_back(tx);
+        geo.texcoord.storage.push_back(ty);
       }
-      vidx_offset += fv;
     }
+    corners[s] = mesh.indices.size();
+  });
+
+  // initialize bounding box
+  bbox = box3f(empty);
+  size_t numCorners = 0, numVertices = 0;
+  for (size_t s = 0; s < geometries.size(); s++) {
+    Geometry &geo = geometries[s];
+    if (!triangular[s]) {
+      ErrorNoExit("this mesh is not a pure trianglar mesh");
+      return false;
+    }
+    if (geo.num_faces <= 0) {
+      WarnAlways("shape #" + std::to_string(s) +
+                 "found one shape with no faces");
+    }
+    // attributes have to be there for all vertices or none
+    if (geo.normal.size() != geo.vertex.size()) {
+      WarnOnce("normal not found");
+      geo.has_normal = false;
+    }
+    if (geo.texcoord.size() / 2 != geo.vertex.size() / 3) {
+      WarnOnce("texture coordinate not found");
+      geo.has_texcoord = false;
+    }
+    bbox.extend(bounds[s]);
+    numCorners  += corners[s];
+    numVertices += geo.vertex.size() / 3;
   }
+  std::cout << "#osp:bench: mesh " << fname << ": " << numVertices
+            << " unique vertices of " << numCorners << " face corners"
+            << std::endl;
 
   center = 0.5f * (bbox.upper + bbox.lower);
   return true;
 }
 
+// ======================================================================== //
+// Binary cache: a header, one entry per geometry and then the arrays of
+// all geometries (vertex, normal, texcoord, index), each starting at a
+// multiple of 64 bytes so that the file can be used as it is mapped
+// ======================================================================== //
+namespace {
+  const char     cacheMagic[8] = {'I', 'M', 'P', 'I', 'M', 'E', 'S', 'H'};
+  const uint32_t cacheVersion  = 1;
+  const size_t   cacheAlign    = 64;
+  struct CacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numGeometries;
+    uint64_t sourceSize; // the OBJ the cache was made from
+    int64_t  sourceTime;
+    float    lower[3];
+    float    upper[3];
+  };
+  struct CacheGeometry {
+    uint64_t numVertex;   // floats
+    uint64_t numNormal;   // floats
+    uint64_t numTexcoord; // floats
+    uint64_t numIndex;    // unsigned ints
+    int32_t  numFaces;
+    int32_t  hasNormal;
+    int32_t  hasTexcoord;
+    int32_t  padding;
+  };
+  size_t CacheAligned(size_t offset)
+  {
+    return (offset + cacheAlign - 1) / cacheAlign * cacheAlign;
+  }
+  bool SourceStamp(const std::string &file, uint64_t &size, int64_t &time)
+  {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) {
+      return false;
+    }
+    size = st.st_size;
+    time = st.st_mtime;
+    return true;
+  }
+};
+
+bool Mesh::LoadCache(const std::string &file)
+{
+  uint64_t sourceSize;
+  int64_t  sourceTime;
+  if (!SourceStamp(fpath, sourceSize, sourceTime)) {
+    return false;
+  }
+  // map the whole file, it stays mapped as long as the mesh lives
+  const char *base = nullptr;
+  size_t bytes = 0;
+#ifdef _WIN32
+  std::ifstream is(file, std::ios::binary | std::ios::ate);
+  if (!is) {
+    return false;
+  }
+  bytes = is.tellg();
+  auto buffer = std::make_shared<std::vector<char>>(bytes);
+  is.seekg(0);
+  if (!is.read(buffer->data(), bytes)) {
+    return false;
+  }
+  base  = buffer->data();
+  cache = buffer;
+#else
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  void *ptr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    bytes = st.st_size;
+    ptr   = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  base  = (const char *)ptr;
+  cache = std::shared_ptr<void>(ptr, [bytes](void *p) { munmap(p, bytes); });
+#endif
+  // check that it belongs to this OBJ and is complete
+  CacheHeader header;
+  if (bytes < sizeof(header)) {
+    cache.reset();
+    return false;
+  }
+  memcpy(&header, base, sizeof(header));
+  const size_t tableEnd = 
+    sizeof(header) + header.numGeometries * sizeof(CacheGeometry);
+  if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+      header.version != cacheVersion ||
+      header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+      bytes < tableEnd) {
+    cache.reset();
+    return false;
+  }
+  std::vector<CacheGeometry> table(header.numGeometries);
+  memcpy(table.data(), base + sizeof(header), 
+         table.size() * sizeof(CacheGeometry));
+  size_t offset = tableEnd;
+  for (const auto &g : table) {
+    for (const uint64_t n : {g.numVertex, g.numNormal, g.numTexcoord}) {
+      offset = CacheAligned(offset) + n * sizeof(float);
+    }
+    offset = CacheAligned(offset) + g.numIndex * sizeof(unsigned int);
+  }
+  if (bytes < offset) {
+    WarnAlways("mesh cache " + file + " is truncated, ignoring it");
+    cache.reset();
+    return false;
+  }
+  // point the geometries into the mapping
+  geometries.clear();
+  geometries.resize(table.size());
+  offset = tableEnd;
+  auto floats = [&](uint64_t n) {
+    offset = CacheAligned(offset);
+    const float *p = (const float *)(base + offset);
+    offset += n * sizeof(float);
+    return p;
+  };
+  for (size_t s = 0; s < table.size(); ++s) {
+    const CacheGeometry &g = table[s];
+    Geometry &geo = geometries[s];
+    geo.vertex.Map(floats(g.numVertex), g.numVertex);
+    geo.normal.Map(floats(g.numNormal), g.numNormal);
+    geo.texcoord.Map(floats(g.numTexcoord), g.numTexcoord);
+    offset = CacheAligned(offset);
+    geo.index.Map((const unsigned int *)(base + offset), g.numIndex);
+    offset += g.numIndex * sizeof(unsigned int);
+    geo.num_faces    = g.numFaces;
+    geo.has_normal   = g.hasNormal != 0;
+    geo.has_texcoord = g.hasTexcoord != 0;
+  }
+  bbox.lower = vec3f(header.lower[0], header.lower[1], header.lower[2]);
+  bbox.upper = vec3f(header.upper[0], header.upper[1], header.upper[2]);
+  center = 0.5f * (bbox.upper + bbox.lower);
+  std::cout << "#osp:bench: mesh " << fname << ": read from cache " 
+            << file << std::endl;
+  return true;
+}
+
+void Mesh::WriteCache(const std::string &file) const
+{
+  CacheHeader header = {};
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version       = cacheVersion;
+  header.numGeometries = geometries.size();
+  if (!SourceStamp(fpath, header.sourceSize, header.sourceTime)) {
+    return;
+  }
+  for (int i = 0; i < 3; ++i) {
+    header.lower[i] = bbox.lower[i];
+    header.upper[i] = bbox.upper[i];
+  }
+  // written under a temporary name, so that a reader never sees a
+  // partial file
+  const std::string tmp = file + ".tmp";
+  std::ofstream os(tmp, std::ios::binary);
+  if (!os) {
+    WarnAlways("cannot write mesh cache " + file);
+    return;
+  }
+  size_t offset = 0;
+  auto write = [&](const void *data, size_t n) {
+    os.write((const char *)data, n);
+    offset += n;
+  };
+  auto pad = [&]() {
+    static const char zeros[cacheAlign] = {};
+    write(zeros, CacheAligned(offset) - offset);
+  };
+  write(&header, sizeof(header));
+  for (const auto &geo : geometries) {
+    CacheGeometry g = {};
+    g.numVertex   = geo.vertex.size();
+    g.numNormal   = geo.normal.size();
+    g.numTexcoord = geo.texcoord.size();
+    g.numIndex    = geo.index.size();
+    g.numFaces    = geo.num_faces;
+    g.hasNormal   = geo.has_normal;
+    g.hasTexcoord = geo.has_texcoord;
+    write(&g, sizeof(g));
+  }
+  for (const auto &geo : geometries) {
+    pad(); write(geo.vertex.data(),   geo.vertex.size()   * sizeof(float));
+    pad(); write(geo.normal.data(),   geo.normal.size()   * sizeof(float));
+    pad(); write(geo.texcoord.data(), geo.texcoord.size() * sizeof(float));
+    pad(); write(geo.index.data(),    geo.index.size()    * sizeof(unsigned int));
+  }
+  os.close();
+  if (!os || std::rename(tmp.c_str(), file.c_str()) != 0) {
+    WarnAlways("cannot write mesh cache " + file);
+    std::remove(tmp.c_str());
+  }
+}
+
 void Mesh::AddToModel(OSPModel model, OSPRenderer renderer, OSPMaterial mtl)
 {
   for (auto &geo : geometries) {
@@ -181,7 +455,7 @@ void Mesh::AddToModel(OSPModel model, OSPRenderer renderer, OSPMaterial mtl)
       // index
       OSPData idata = ospNewData(geo.index.size() / 3,
                                  OSP_INT3,
-                                 geo.index.data(),
+                                 (void *)geo.index.data(),
                                  OSP_DATA_SHARED_BUFFER);
       ospCommit(idata);
       ospSetObject(gdata, "index", idata);
@@ -190,7 +464,7 @@ void Mesh::AddToModel(OSPModel model, OSPRenderer renderer, OSPMaterial mtl)
       // vertex
       OSPData vdata = ospNewData(geo.vertex.size() / 3,
                                  OSP_FLOAT3,
-                                 geo.vertex.data(),
+                                 (void *)geo.vertex.data(),
                                  OSP_DATA_SHARED_BUFFER);
       ospCommit(vdata);
       ospSetObject(gdata, "vertex", vdata);
@@ -200,7 +474,7 @@ void Mesh::AddToModel(OSPModel model, OSPRenderer renderer, OSPMaterial mtl)
       if (geo.has_normal) {
         OSPData ndata = ospNewData(geo.normal.size() / 3,
                                    OSP_FLOAT3,
-                                   geo.normal.data(),
+                                   (void *)geo.normal.data(),
                                    OSP_DATA_SHARED_BUFFER);
         ospCommit(ndata);
         ospSetObject(gdata, "vertex.normal", ndata);
@@ -211,7 +485,7 @@ void Mesh::AddToModel(OSPModel model, OSPRenderer renderer, OSPMaterial mtl)
       if (geo.has_texcoord) {
         OSPData tdata = ospNewData(geo.texcoord.size() / 2,
                                    OSP_FLOAT2,
-                                   geo.texcoord.data(),
+                                   (void *)geo.texcoord.data(),
                                    OSP_DATA_SHARED_BUFFER);
         ospCommit(tdata);
         ospSetObject(gdata, "vertex.texcoord", tdata);
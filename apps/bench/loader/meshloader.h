@@ -12,17 +12,30 @@
 // trying this obj loader https://github.com/syoyo/tinyobjloader
 #include "tiny_obj_loader.h"
 
+#include <memory>
+
 using namespace ospcommon;
 
 /** \brief structure for a triangular mesh */
 class Mesh {
  private:
-  //! one geometry contains a continious mesh plus one material index
+  //! an array either held in 'storage' or pointing into the mapped
+  //! cache file (see LoadFromFileObj)
+  template<typename T> struct Array {
+    std::vector<T> storage;
+    const T* mapped = nullptr;
+    size_t   count  = 0;
+    const T* data() const { return mapped ? mapped : storage.data(); }
+    size_t   size() const { return mapped ? count  : storage.size(); }
+    void Map(const T* p, size_t n) { storage.clear(); mapped = p; count = n; }
+  };
+  //! one geometry contains a continious mesh plus one material index.
+  //! vertices shared by faces are stored once
   struct Geometry {
-    std::vector<float> vertex;
-    std::vector<float> normal;
-    std::vector<float> texcoord;
-    std::vector<unsigned int> index;
+    Array<float> vertex;
+    Array<float> normal;
+    Array<float> texcoord;
+    Array<unsigned int> index;
     int num_faces =  0;
     bool has_normal   = false;
     bool has_texcoord = false;
@@ -45,8 +58,12 @@ class Mesh {
   std::string fpath; // directory path to the mesh folder
   std::string fname; // filename of the mesh
   std::vector<Geometry> geometries;
+  std::shared_ptr<void> cache; // keeps the mapped cache file alive
  private:
   void ComputePath(const std::string& str);
+  bool BuildGeometries();
+  bool LoadCache(const std::string& file);
+  void WriteCache(const std::string& file) const;
  public:
   /** \brief Accessors */
   std::string GetFullPath()
@@ -76,9 +93,14 @@ class Mesh {
   void SetTransform(const affine3f&);
   /** 
    * \brief Overriding LoadFromFileObj function for TriMesh,
-   *  force to triangulate
+   *  force to triangulate. 
+   *  the indexed geometries are cached in '<filename>.cache' and read
+   *  back (mapped) on the next load, unless the OBJ changed since or
+   *  'useCache' (or IMPI_MESH_CACHE=0) says otherwise. the cache only
+   *  holds geometries, loading materials always parses the OBJ
    */
-  bool LoadFromFileObj(const char* filename, bool loadMtl = false);
+  bool LoadFromFileObj(const char* filename, bool loadMtl = false,
+                       bool useCache = true);
   /**
    * \brief OSPRay helper     
    */
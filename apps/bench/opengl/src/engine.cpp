@@ -3,6 +3,8 @@
 // ======================================================================== //
 #include "engine.h"
 #include "scene/properties.h"
+#include <chrono>
+#include <limits>
 void viewer::Engine::Validate()
 {
   if (fbState == ExecState::INVALID)
@@ -15,43 +17,123 @@ void viewer::Engine::Start() {
   // start the thread
   fbState = ExecState::RUNNING;
   fbThread = std::make_unique<std::thread>([&] {
+      typedef std::chrono::steady_clock clock;
+      auto lastChange = clock::now();
+      // estimated time of one sample per pixel at full resolution
+      float sampleTime = 0.f;
+      int accumulation = 0;
+      int samples      = 0;
+      int rendererSpp  = -1; // what "spp" of the renderer is, -1: unknown
+      bool converged   = false;
+      const uint32_t accumChannels = 
+        OSP_FB_COLOR | OSP_FB_ACCUM | OSP_FB_VARIANCE;
       while (fbState != ExecState::STOPPED) {
         // check if we need to resize
         if (fbSize.update()) {
           // resize buffer
           ospcommon::vec2i size = fbSize.get();
           fbNumPixels = size.x * size.y;
-          fbBuffers.front().resize(fbNumPixels);
-          fbBuffers.back().resize(fbNumPixels);
-          // resize ospray framebuffer
-          if (ospFB != nullptr) {
-            ospUnmapFrameBuffer(ospFBPtr, ospFB);
-            ospFreeFrameBuffer(ospFB);
-            ospFB = nullptr;
+          if (!fbExternal) {
+            for (int i = 0; i < 3; ++i) {
+              fbStorage[i].resize(fbNumPixels);
+              fbSlots[i] = fbStorage[i].data();
+            }
           }
-          ospFB = ospNewFrameBuffer((osp::vec2i&)size, 
-                                    OSP_FB_SRGBA, 
-                                    OSP_FB_COLOR | OSP_FB_ACCUM);
-          ospFrameBufferClear(ospFB, OSP_FB_COLOR | OSP_FB_ACCUM);
-          ospFBPtr = (uint32_t *) ospMapFrameBuffer(ospFB, OSP_FB_COLOR);
+          // resize ospray framebuffers, only full resolution accumulates
+          Delete();
+          for (int l = 0; l < fbNumLevels; ++l) {
+            const int channels = l == 0 ? accumChannels : OSP_FB_COLOR;
+            const vec2i lsize = max(size / (1 << l), vec2i(1));
+            ospFB[l] = ospNewFrameBuffer((const osp::vec2i&)lsize, 
+                                         OSP_FB_SRGBA, channels);
+            ospFrameBufferClear(ospFB[l], channels);
+            ospFBPtr[l] = (uint32_t *) ospMapFrameBuffer(ospFB[l], OSP_FB_COLOR);
+          }
+          sampleTime   = 0.f;
+          accumulation = 0;
+          samples      = 0;
+          converged    = false;
         }
         // clear a frame
-        if (fbClear || viewer::widgets::Commit()) {
+        if (viewer::widgets::Commit()) {
+          // the props may have committed the renderer's own "spp"
+          rendererSpp = -1;
+          fbClear = true;
+        }
+        if (fbClear) {
           fbClear = false;
-          ospFrameBufferClear(ospFB, OSP_FB_COLOR | OSP_FB_ACCUM);
+          ospFrameBufferClear(ospFB[0], accumChannels);
+          lastChange = clock::now();
+          accumulation = 0;
+          samples      = 0;
+          converged    = false;
+        }
+        // nothing changed since the image converged, poll for changes
+        // without keeping the cores busy
+        if (converged) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          continue;
+        }
+        // pick the resolution: the smallest reduction that is estimated
+        // to meet the target time while things change, full otherwise
+        const bool interacting = std::chrono::duration<float>
+          (clock::now() - lastChange).count() < fbSettleTime;
+        int level = 0;
+        if (interacting) {
+          while (level + 1 < fbNumLevels &&
+                 sampleTime * fbMinSpp / (1 << (2 * level)) > fbTargetTime) {
+            ++level;
+          }
+        }
+        // pick the samples per pixel: the minimum while interacting,
+        // as many as fit into the target time once settled
+        int spp = fbMinSpp;
+        if (level == 0 && !interacting && sampleTime > 0.f) {
+          spp = std::max(spp, std::min(fbMaxSpp, 
+                                       int(fbTargetTime / sampleTime)));
+        }
+        if (spp != rendererSpp) {
+          ospSet1i(ospRen, "spp", spp);
+          ospCommit(ospRen);
+          rendererSpp = spp;
         }
         // render a frame
-        ospRenderFrame(ospFB, ospRen, OSP_FB_COLOR | OSP_FB_ACCUM);
-        // map
-        auto *srcPB = (uint32_t*)ospFBPtr;
-        auto *dstPB = (uint32_t*)fbBuffers.back().data();
-        memcpy(dstPB, srcPB, fbNumPixels * sizeof(uint32_t));
-        // swap
-        if (fbMutex.try_lock()) {
-          fbBuffers.swap();
-          fbHasNewFrame = true;
-          fbMutex.unlock();
+        const vec2i size = max(fbSize.get() / (1 << level), vec2i(1));
+        const auto t0 = clock::now();
+        const float variance = 
+          ospRenderFrame(ospFB[level], ospRen, 
+                         level == 0 ? accumChannels : OSP_FB_COLOR);
+        const float t = std::chrono::duration<float>(clock::now() - t0).count();
+        sampleTime = t * (1 << (2 * level)) / spp;
+        fbLevel = level;
+        accumulation = level == 0 ? accumulation + 1 : 0;
+        samples      = level == 0 ? samples + spp    : 0;
+        if (level == 0) {
+          const float threshold = fbVarianceThreshold;
+          const int   limit     = fbSampleLimit;
+          converged = (threshold > 0.f && variance < threshold) ||
+                      (limit > 0 && samples >= limit);
         }
+        // the one copy out of ospray's framebuffer. it stays mapped
+        // from the resize until Delete(), but the next frame renders
+        // into the same memory, so the pixels have to leave it now
+        const auto t1 = clock::now();
+        memcpy(fbSlots[fbBack], ospFBPtr[level],
+               size.x * size.y * sizeof(uint32_t));
+        FrameInfo &info   = fbSlotInfo[fbBack];
+        info.size         = size;
+        info.level        = level;
+        info.accumulation = accumulation;
+        info.spp          = spp;
+        info.samples      = samples;
+        info.variance     = level == 0 ? variance
+                                   : std::numeric_limits<float>::infinity();
+        info.converged    = converged;
+        info.renderTime   = t;
+        info.copyTime     = std::chrono::duration<float>
+          (clock::now() - t1).count();
+        // publish
+        fbBack = fbReady.exchange(fbBack | fbNewFrame) & ~fbNewFrame;
       }
     });
 }
@@ -62,16 +144,23 @@ void viewer::Engine::Stop() {
   fbThread->join();
   fbThread.reset();
 }
-bool viewer::Engine::HasNewFrame() { return fbHasNewFrame; };
-const std::vector<uint32_t>& viewer::Engine::MapFramebuffer()
+bool viewer::Engine::HasNewFrame() { return fbReady & fbNewFrame; };
+int viewer::Engine::AcquireFrame()
 {
-  fbMutex.lock();
-  fbHasNewFrame = false;
-  return fbBuffers.front();
+  if (fbReady & fbNewFrame) {
+    fbFront = fbReady.exchange(fbFront) & ~fbNewFrame;
+  }
+  return fbFront;
 }
-void viewer::Engine::UnmapFramebuffer()
+void viewer::Engine::SetFrameSlots(uint32_t *const *slots)
 {
-  fbMutex.unlock();
+  fbExternal = slots != nullptr;
+  for (int i = 0; i < 3; ++i) {
+    fbStorage[i].resize(fbExternal ? 0 : fbNumPixels);
+    fbSlots[i] = fbExternal ? slots[i] : fbStorage[i].data();
+  }
+  // whatever was in the slots is gone
+  fbReady = fbReady & ~fbNewFrame;
 }
 void viewer::Engine::Resize(size_t width, size_t height) 
 {
@@ -88,9 +177,11 @@ void viewer::Engine::Clear()
 }
 void viewer::Engine::Delete() 
 {
-  if (ospFB != nullptr) {
-    ospUnmapFrameBuffer(ospFBPtr, ospFB); 
-    ospFreeFrameBuffer(ospFB);
-    ospFB = nullptr;
+  for (int l = 0; l < fbNumLevels; ++l) {
+    if (ospFB[l] != nullptr) {
+      ospUnmapFrameBuffer(ospFBPtr[l], ospFB[l]); 
+      ospFreeFrameBuffer(ospFB[l]);
+      ospFB[l] = nullptr;
+    }
   }
 }
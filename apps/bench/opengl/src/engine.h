@@ -9,9 +9,9 @@
 // ospcommon
 #include "ospray/ospray.h"
 #include "ospcommon/vec.h"
-#include "ospcommon/utility/DoubleBufferedValue.h"
 #include "ospcommon/utility/TransactionalValue.h"
 // std
+#include <algorithm>
 #include <thread>
 #include <atomic>
 #include <mutex>
@@ -23,28 +23,89 @@ namespace viewer {
   class Engine {
   public:
     enum ExecState {STOPPED, RUNNING, INVALID};
+    //! how a frame was made, travels with its slot
+    struct FrameInfo {
+      vec2i size;             //!< smaller than the window while interacting
+      int   level{0};         //!< resolution level, 0 is full resolution
+      int   accumulation{0};  //!< frames accumulated into it (level 0)
+      int   spp{1};           //!< samples per pixel of this frame
+      int   samples{0};       //!< samples per pixel accumulated (level 0)
+      float variance{0.f};    //!< ospray's estimate, inf until known
+      bool  converged{false}; //!< the engine stopped after this frame
+      float renderTime{0.f};  //!< seconds in ospRenderFrame
+      float copyTime{0.f};    //!< seconds copying it into the slot
+    };
   private:
     std::unique_ptr<std::thread> fbThread;
     std::atomic<ExecState>       fbState{ExecState::INVALID};
-    std::mutex                   fbMutex;
-    std::atomic<bool>            fbHasNewFrame{false};
     std::atomic<bool>            fbClear{false};
     ospcommon::utility::TransactionalValue<vec2i>
       fbSize;
-    ospcommon::utility::DoubleBufferedValue<std::vector<uint32_t>> 
-      fbBuffers;
+    // triple buffered hand-off: the render thread copies each frame
+    // into slot 'fbBack' and swaps it with 'fbReady', the display
+    // swaps 'fbReady' with its 'fbFront'. only slot indices change
+    // hands, pixels are never copied between the threads
+    static const int fbNewFrame = 4; // flag in fbReady
+    std::vector<uint32_t> fbStorage[3];
+    uint32_t             *fbSlots[3]{nullptr, nullptr, nullptr};
+    bool                  fbExternal{false};
+    int                   fbBack{0};  // render thread only
+    int                   fbFront{2}; // display thread only
+    std::atomic<int>      fbReady{1};
+    FrameInfo             fbSlotInfo[3];
     int fbNumPixels{0};
+    // adaptive resolution: while the camera or parameters change,
+    // frames are rendered at 1/2^level of the width and height, with
+    // the level picked so that a frame takes about fbTargetTime. once
+    // nothing changed for fbSettleTime, level 0 (full resolution,
+    // accumulating) takes over again
+    static const int fbNumLevels = 4;
+    std::atomic<float> fbTargetTime{1.f / 20.f};
+    float              fbSettleTime{0.2f};
+    std::atomic<int>   fbLevel{0};
+    // adaptive sampling: at full resolution each frame takes as many
+    // samples per pixel as fit into fbTargetTime (at least fbMinSpp).
+    // accumulation stops once ospray's variance estimate is below
+    // fbVarianceThreshold or fbSampleLimit samples are reached (0
+    // disables either), and the render thread idles until something
+    // changes
+    static const int   fbMaxSpp = 64;
+    std::atomic<int>   fbMinSpp{1};
+    std::atomic<float> fbVarianceThreshold{0.f};
+    std::atomic<int>   fbSampleLimit{0};
   private:
-    uint32_t      *ospFBPtr;
-    OSPFrameBuffer ospFB  = nullptr;
+    uint32_t      *ospFBPtr[fbNumLevels] = {};
+    OSPFrameBuffer ospFB[fbNumLevels]    = {};
     OSPRenderer    ospRen = nullptr;
   public:
     void Validate();
     void Start();
     void Stop();
     bool HasNewFrame();
-    const std::vector<uint32_t> &MapFramebuffer();
-    void UnmapFramebuffer();
+    //! take the newest frame for display and return its slot. the
+    //! render thread leaves the slot alone until the next call
+    int  AcquireFrame();
+    const uint32_t *FramePixels(int slot) const { return fbSlots[slot]; }
+    //! size of the frame in 'slot', smaller than the window while
+    //! interacting
+    vec2i FrameSize(int slot) const { return fbSlotInfo[slot].size; }
+    const FrameInfo& FrameStats(int slot) const { return fbSlotInfo[slot]; }
+    //! resolution level of the last frame, 0 is full resolution
+    int  FrameLevel() const { return fbLevel; }
+    void SetTargetFrameTime(float seconds) { fbTargetTime = seconds; }
+    //! see fbMinSpp, safe to call from the render thread (i.e. from
+    //! viewer::widgets::Commit)
+    void SetSampling(int minSpp, float varianceThreshold, int sampleLimit)
+    {
+      fbMinSpp            = std::max(minSpp, 1);
+      fbVarianceThreshold = varianceThreshold;
+      fbSampleLimit       = sampleLimit;
+    }
+    //! let the render thread copy frames straight into 'slots' (e.g.
+    //! persistently mapped pixel buffers, each large enough for the
+    //! current size) instead of the engine's own memory. must only be
+    //! called while stopped, nullptr switches back
+    void SetFrameSlots(uint32_t *const *slots);
     void Resize(size_t width, size_t height);
     void Init(size_t width, size_t height, OSPRenderer ren);
     void Clear();
@@ -7,6 +7,9 @@
 #include <imgui_glfw_impi.h>
 #include "widgets/TransferFunctionWidget.h"
 
+#include <chrono>
+#include <string>
+
 // ======================================================================== //
 //
 // ======================================================================== //
@@ -187,6 +190,13 @@ void viewer::RendererProp::Draw()
   if (ImGui::SliderInt("spp", &imgui_spp, 0, 100, "%.0f")) {
     spp = imgui_spp;
   }
+  if (ImGui::SliderFloat("varianceThreshold", &imgui_varianceThreshold,
+                         0.f, 0.1f, "%.4f", 3.0f)) {
+    varianceThreshold = imgui_varianceThreshold;
+  }
+  if (ImGui::SliderInt("sampleLimit", &imgui_sampleLimit, 0, 4096, "%.0f")) {
+    sampleLimit = imgui_sampleLimit;
+  }
   if (ImGui::SliderInt("aoSamples", &imgui_aoSamples, 0, 100, "%.0f")) {
     aoSamples = imgui_aoSamples;
   }
@@ -227,7 +237,15 @@ bool viewer::RendererProp::Commit()
     update = true;
   }
   if (spp.update()) {
-    ospSet1i(self, "spp", spp.ref());
+    // the engine sets "spp", this is the least it uses
+    update = true;
+  }
+  if (varianceThreshold.update()) {
+    // ospray stops rendering tiles whose error is below it
+    ospSet1f(self, "varianceThreshold", varianceThreshold.ref());
+    update = true;
+  }
+  if (sampleLimit.update()) {
     update = true;
   }
   if (autoEpsilon.update()) {
@@ -324,3 +342,122 @@ bool viewer::TransferFunctionProp::Commit()
   return update;
 }
 
+
+// ======================================================================== //
+//
+// ======================================================================== //
+viewer::ImpiProp::~ImpiProp()
+{
+  if (worker) { worker->join(); }
+  OSPModel m = ready.exchange(nullptr);
+  if (m != nullptr) { ospRelease(m); }
+}
+OSPModel viewer::ImpiProp::TimedRebuild(const std::vector<IsoSurface>& s)
+{
+  const auto t = std::chrono::steady_clock::now();
+  OSPModel m = rebuild(s);
+  lastRebuildTime = std::chrono::duration<float>
+    (std::chrono::steady_clock::now() - t).count();
+  return m;
+}
+void viewer::ImpiProp::StartRebuild()
+{
+  if (worker) { worker->join(); }
+  working = true;
+  const std::vector<IsoSurface> s = surfaces;
+  worker = std::make_unique<std::thread>([this, s] {
+      OSPModel m = TimedRebuild(s);
+      // a model the render thread did not pick up yet is outdated
+      if (m != nullptr) {
+        OSPModel stale = ready.exchange(m);
+        if (stale != nullptr) { ospRelease(stale); }
+      }
+      working = false;
+    });
+}
+void viewer::ImpiProp::Draw()
+{
+  if (!Enabled()) { return; }
+  for (size_t i = 0; i < surfaces.size(); ++i) {
+    const std::string name = std::to_string(i);
+    ImVec4 picked_color = ImColor(surfaces[i].color.x,
+                                  surfaces[i].color.y,
+                                  surfaces[i].color.z, 1.f);
+    if (ImGui::ColorEdit4(("color##iso" + name).c_str(),
+                          (float *) &picked_color,
+                          ImGuiColorEditFlags_NoAlpha |
+                          ImGuiColorEditFlags_NoInputs |
+                          ImGuiColorEditFlags_NoLabel |
+                          ImGuiColorEditFlags_NoOptions |
+                          ImGuiColorEditFlags_NoTooltip)) {
+      surfaces[i].color = osp::vec3f{picked_color.x,
+                                     picked_color.y,
+                                     picked_color.z};
+      // only the material changes, nothing is rebuilt
+      std::lock_guard<std::mutex> lock(pendingMutex);
+      colors.emplace_back(i, surfaces[i].color);
+    }
+    ImGui::SameLine();
+    if (ImGui::SliderFloat(("iso-value##" + name).c_str(), 
+                           &surfaces[i].value,
+                           valueRange[0], valueRange[1], "%.4f")) {
+      dirty = true;
+    }
+  }
+  // one rebuild at a time, edits made meanwhile go into the next one
+  if (!working && !requested && dirty) {
+    dirty = false;
+    if (background) { StartRebuild(); }
+    else {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+      pending   = surfaces;
+      requested = true;
+    }
+  }
+  if (working || requested) {
+    uint64_t done = 0, total = 0;
+    if (progress) { progress(done, total); }
+    if (total > 0) {
+      const std::string label = std::to_string(done) + "/" + 
+        std::to_string(total) + " leaves";
+      ImGui::ProgressBar(done / float(total), ImVec2(-1.f, 0.f), 
+                         label.c_str());
+    } else {
+      ImGui::ProgressBar(1.f, ImVec2(-1.f, 0.f), "building BVH");
+    }
+  } else if (lastRebuildTime > 0.f) {
+    ImGui::Text("last rebuild %.3fs", lastRebuildTime);
+  }
+}
+bool viewer::ImpiProp::Commit()
+{
+  bool update = false;
+  std::vector<std::pair<size_t, osp::vec3f>> c;
+  std::vector<IsoSurface> s;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    c.swap(colors);
+    if (requested) { s.swap(pending); }
+  }
+  for (const auto& e : c) { recolor(e.first, e.second); }
+  update = !c.empty();
+  if (requested) {
+    // no background thread: build between two frames
+    working   = true;
+    requested = false;
+    OSPModel m = TimedRebuild(s);
+    working   = false;
+    if (m != nullptr) {
+      OSPModel stale = ready.exchange(m);
+      if (stale != nullptr) { ospRelease(stale); }
+    }
+  }
+  OSPModel m = ready.exchange(nullptr);
+  if (m == nullptr) { return update; }
+  ospSetObject(self, "model", m);
+  ospCommit(self);
+  if (ownsModel) { ospRelease(model); }
+  model     = m;
+  ownsModel = true;
+  return true;
+}
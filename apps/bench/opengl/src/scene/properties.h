@@ -16,7 +16,15 @@ namespace viewer { namespace widgets { bool Commit(); };};
 #include "ospcommon/utility/TransactionalValue.h"
 /* imgui */
 #include "widgets/TransferFunctionWidget.h"
+/* viewer */
+#include "../../viewer.h"
 /* stl */
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 #include <vector>
 
 // ======================================================================== //
@@ -146,6 +154,7 @@ namespace viewer {
     Setter(maxDepth, MaxDepth, int, 20);
     Setter(minContribution, MinContribution, float, 0.001f);
     Setter(varianceThreshold, VarianceThreshold, float, 0.f);
+    Setter(sampleLimit, SampleLimit, int, 1024);
     Setter(bgColor, BgColor, ospcommon::vec4f, ospcommon::vec4f(0.f));
     // ==== scivis renderer ===== //
     Setter(shadowsEnabled, ShadowsEnabled, bool, false);
@@ -160,6 +169,12 @@ namespace viewer {
   public:
     RendererProp(CameraProp& c, LightListProp& l);
     OSPRenderer& operator*() { return self; }
+    int Spp() const { return imgui_spp; }
+    //! what the engine needs for adaptive sampling (spp is the minimum
+    //! it renders with), as committed: only call after Commit
+    int   MinSpp()            { return spp.ref(); }
+    float VarianceThreshold() { return varianceThreshold.ref(); }
+    int   SampleLimit()       { return sampleLimit.ref(); }
     void Init(OSPRenderer renderer, const Type& t);
     void Draw();
     bool Commit();
@@ -195,6 +210,71 @@ namespace viewer {
     bool Commit();
     void Print();
   };
+
+  // ====================================================================== //
+  // Implicit iso-surfaces: a color edit is handed to the render thread,
+  // which updates that surface's material between two frames. an
+  // iso-value edit is turned into a new model on a background thread
+  // (extraction and BVH build happen there) while the current surfaces
+  // keep rendering, the render thread only swaps the finished model in.
+  // the background thread creates and commits new objects only, it never
+  // touches the model or renderer being rendered. that is safe with the
+  // local device (objects are independent, their refcounts atomic) but
+  // not with a distributed one, which gets 'background' false and builds
+  // on the render thread instead. while a rebuild is running further
+  // edits are collected, the latest one is built next
+  // ====================================================================== //
+  class ImpiProp : public Prop
+  {
+  public:
+    typedef std::function<OSPModel(const std::vector<IsoSurface>&)> Rebuild;
+    typedef std::function<void(size_t, const osp::vec3f&)> Recolor;
+    typedef std::function<void(uint64_t&, uint64_t&)> Progress;
+  private:
+    OSPRenderer self{nullptr};
+    OSPModel model{nullptr};
+    bool ownsModel{false}; // the first model belongs to the application
+    Rebuild rebuild;
+    Recolor recolor;
+    Progress progress;
+    bool background{true};
+    float valueRange[2] = {0.f, 1.f};
+    std::vector<IsoSurface> surfaces; // as edited, ui thread only
+    bool dirty{false};
+    std::mutex              pendingMutex;
+    std::vector<IsoSurface> pending;  // render thread builds it (!background)
+    std::vector<std::pair<size_t, osp::vec3f>> colors; // render thread applies
+    std::unique_ptr<std::thread> worker;
+    std::atomic<bool>       requested{false};
+    std::atomic<bool>       working{false};
+    std::atomic<OSPModel>   ready{nullptr};
+    std::atomic<float>      lastRebuildTime{0.f};
+  public:
+    ImpiProp() = default;
+    ~ImpiProp();
+    OSPModel& operator*() { return model; }
+    void Create(const std::vector<IsoSurface>& s,
+                const float a, const float b,
+                const Rebuild& r, const Recolor& c, const Progress& p,
+                const bool bg)
+    {
+      surfaces = s;
+      valueRange[0] = a;
+      valueRange[1] = b;
+      rebuild    = r;
+      recolor    = c;
+      progress   = p;
+      background = bg;
+    }
+    void Init(OSPRenderer renderer, OSPModel m) { self = renderer; model = m; }
+    bool Enabled() const { return bool(rebuild); }
+    void Draw();
+    //! render thread: apply color edits and swap in a finished model
+    bool Commit();
+  private:
+    void StartRebuild();
+    OSPModel TimedRebuild(const std::vector<IsoSurface>& s);
+  };
 };
 #undef Setter
 #undef TValue
@@ -9,7 +9,10 @@
 # define GLFW_EXPOSE_NATIVE_WGL
 # include <GLFW/glfw3native.h>
 #endif
+#include <cfloat>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 //! @name error check helper from EPFL ICG class
 static inline const char *ErrorString(GLenum error) {
   const char *msg;
@@ -55,7 +58,6 @@ static affine3f Identity(vec3f(1, 0, 0),
                          vec3f(0, 0, 1),
                          vec3f(0, 0, 0));
 static std::vector<GLFWwindow *> windowmap;
-static std::vector<uint32_t> displaybuffer;
 
 // ======================================================================== //
 static OSPModel              ospMod;
@@ -65,15 +67,19 @@ static CameraProp               camProp;
 static LightListProp            litProp;
 static RendererProp             renProp(camProp, litProp);
 static TransferFunctionProp     tfnProp;
+static ImpiProp                 impProp;
 
 static Engine engine;
 static Camera camera(camProp);
 bool viewer::widgets::Commit() {
   bool update = false;
+  if (impProp.Commit()) { ospMod = *impProp; update = true; }
   if (camProp.Commit()) { update = true; }
   if (litProp.Commit()) { update = true; }
   if (renProp.Commit()) { update = true; }
   if (tfnProp.Commit()) { update = true; }
+  engine.SetSampling(renProp.MinSpp(), renProp.VarianceThreshold(),
+                     renProp.SampleLimit());
   return update;
 }
 
@@ -87,8 +93,64 @@ void WidgetInit(GLFWwindow *window) {
 void WidgetStop() { 
   ImGui_Impi_Shutdown();
 }
+// ======================================================================== //
+// Performance HUD
+// ======================================================================== //
+static bool       hudShow = true;
+static const int  hudHistory = 128;
+static float      hudFrameTimes[hudHistory] = {}; // ms, ring buffer
+static int        hudNext = 0;
+static Engine::FrameInfo hudFrame;           // last displayed frame
+static float      hudUploadTime = 0.f;       // seconds
+static std::mutex hudBuildLock;
+static BuildStats hudBuild;
+void viewer::SetBuildStats(const BuildStats& stats)
+{
+  std::lock_guard<std::mutex> lock(hudBuildLock);
+  hudBuild = stats;
+}
+void HudRecord(const Engine::FrameInfo& info, float uploadTime)
+{
+  hudFrame = info;
+  hudUploadTime = uploadTime;
+  hudFrameTimes[hudNext] = 1000.f * info.renderTime;
+  hudNext = (hudNext + 1) % hudHistory;
+}
+void HudDraw() {
+  if (!hudShow) { return; }
+  BuildStats build;
+  {
+    std::lock_guard<std::mutex> lock(hudBuildLock);
+    build = hudBuild;
+  }
+  const float t = hudFrame.renderTime;
+  // primary rays only: one per pixel and sample
+  const double rays = double(hudFrame.size.x) * hudFrame.size.y *
+    hudFrame.spp;
+  ImGui::Begin("Performance", &hudShow, ImGuiWindowFlags_AlwaysAutoResize);
+  ImGui::PlotLines("##frametime", hudFrameTimes, hudHistory, hudNext,
+                   "frame (ms)", 0.f, FLT_MAX, ImVec2(256.f, 64.f));
+  ImGui::Text("frame     %8.2f ms  %6.1f fps", 1000.f * t, 
+              t > 0.f ? 1.f / t : 0.f);
+  ImGui::Text("rays      %8.2f Mrays/s", t > 0.f ? rays / t * 1e-6 : 0.0);
+  ImGui::Text("size      %4d x %-4d (level %d)", 
+              hudFrame.size.x, hudFrame.size.y, hudFrame.level);
+  ImGui::Text("accum     %8d frames %d spp", hudFrame.accumulation,
+              hudFrame.samples);
+  ImGui::Text("sampling  %8d spp%s", hudFrame.spp,
+              hudFrame.converged ? "  (converged, idle)" : "");
+  ImGui::Text("variance  %8.5f", hudFrame.variance);
+  ImGui::Text("copy      %8.3f ms", 1000.f * hudFrame.copyTime);
+  ImGui::Text("upload    %8.3f ms", 1000.f * hudUploadTime);
+  ImGui::Separator();
+  ImGui::Text("extract   %8.3f s", build.extractTime);
+  ImGui::Text("bvh build %8.3f s", build.bvhTime);
+  ImGui::Text("active    %8.3f M voxels", build.activeVoxels * 1e-6);
+  ImGui::End();
+}
 void WidgetDraw() {
   ImGui_Impi_NewFrame();
+  HudDraw();
   tfnProp.Draw();
   ImGui::Begin("Rendering Properties");
   {
@@ -99,6 +161,11 @@ void WidgetDraw() {
     litProp.Draw();    
   }
   ImGui::End();
+  if (impProp.Enabled()) {
+    ImGui::Begin("Implicit Iso-Surfaces");
+    impProp.Draw();
+    ImGui::End();
+  }
   ImGui::Render();
 }
 
@@ -136,6 +203,10 @@ namespace viewer {
     ospSetData(ospRen, "lights", *litProp);
     ospCommit(ospRen);
     engine.Init(camera.CameraWidth(), camera.CameraHeight(), ospRen);
+    // frame rate to keep up while interacting (reduces the resolution)
+    if (const char *fps = getenv("IMPI_VIEWER_TARGET_FPS")) {
+      engine.SetTargetFrameTime(1.f / std::max(1.f, (float)atof(fps)));
+    }
     RenderWindow(windowmap[id]);
   };
   void Handler(OSPCamera c, const std::string& type,
@@ -154,18 +225,141 @@ namespace viewer {
     ospMod = m;
     ospRen = r;
     renProp.Init(r, viewer::RendererProp::Scivis);
+    impProp.Init(r, m);
   };
   void Handler(OSPTransferFunction t, const float &a, const float &b)
   {
     tfnProp.Create(t, a, b);
   };
+  void Handler(const std::vector<IsoSurface>& s,
+               const float &a, const float &b,
+               std::function<OSPModel(const std::vector<IsoSurface>&)> r,
+               std::function<void(size_t, const osp::vec3f&)> c,
+               std::function<void(uint64_t&, uint64_t&)> p,
+               bool bg)
+  {
+    impProp.Create(s, a, b, r, c, p, bg);
+  };
 }; // namespace viewer
 
+static GLuint texID;
+static GLuint fboID;
+
+// ======================================================================== //
+// Frame Upload
+// ======================================================================== //
+// one pixel buffer per engine slot, persistently mapped so that the
+// render thread copies frames straight into memory the driver can
+// upload from (GL 4.4 or ARB_buffer_storage, which glad does not load).
+// without it, frames are uploaded from the engine's slots directly
+#ifndef GL_MAP_PERSISTENT_BIT
+# define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+# define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size,
+                                           const void *data, GLbitfield flags);
+static BufferStorageProc glBufferStorageFcn = nullptr;
+static GLuint    pboIDs[3]    = {0, 0, 0};
+static uint32_t *pboPtrs[3]   = {nullptr, nullptr, nullptr};
+static GLsync    pboFences[3] = {nullptr, nullptr, nullptr};
+static int       displaySlot  = -1; // slot the texture was uploaded from
+static vec2i     displaySize;       // size of that frame in the texture
+void DeletePixelBuffers()
+{
+  for (int i = 0; i < 3; ++i) {
+    if (pboFences[i]) {
+      glDeleteSync(pboFences[i]);
+      pboFences[i] = nullptr;
+    }
+    if (pboIDs[i]) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs[i]);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glDeleteBuffers(1, &pboIDs[i]);
+      pboIDs[i]  = 0;
+      pboPtrs[i] = nullptr;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+//! (re)create the pixel buffers for a frame size and hand them to the
+//! engine, which has to be stopped
+void CreatePixelBuffers(size_t width, size_t height)
+{
+  DeletePixelBuffers();
+  displaySlot = -1;
+  displaySize = vec2i(0);
+  if (!glBufferStorageFcn || width * height == 0) {
+    engine.SetFrameSlots(nullptr);
+    return;
+  }
+  const GLsizeiptr bytes = width * height * sizeof(uint32_t);
+  const GLbitfield flags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(3, pboIDs);
+  for (int i = 0; i < 3; ++i) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs[i]);
+    glBufferStorageFcn(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, flags);
+    pboPtrs[i] = (uint32_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                              0, bytes, flags);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  check_error_gl("Create Pixel Buffers");
+  if (!pboPtrs[0] || !pboPtrs[1] || !pboPtrs[2]) {
+    std::cerr << "#osp:viewer: cannot map pixel buffers, "
+              << "uploading from client memory" << std::endl;
+    DeletePixelBuffers();
+    glBufferStorageFcn = nullptr;
+    engine.SetFrameSlots(nullptr);
+    return;
+  }
+  engine.SetFrameSlots(pboPtrs);
+}
+//! upload the newest frame of the engine into the texture, if any
+void UploadFrame()
+{
+  if (!engine.HasNewFrame())
+    return;
+  const auto t0 = std::chrono::steady_clock::now();
+  // the slot displayed so far goes back to the render thread, which
+  // must not overwrite it while the GPU still reads from it
+  if (displaySlot >= 0 && pboFences[displaySlot]) {
+    glClientWaitSync(pboFences[displaySlot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GLuint64(1000000000));
+    glDeleteSync(pboFences[displaySlot]);
+    pboFences[displaySlot] = nullptr;
+  }
+  displaySlot = engine.AcquireFrame();
+  // frames rendered at reduced resolution only fill the lower left
+  // corner of the texture, the blit scales them up
+  displaySize = min(engine.FrameSize(displaySlot),
+                    vec2i(camera.CameraWidth(), camera.CameraHeight()));
+  glBindTexture(GL_TEXTURE_2D, texID);
+  if (pboIDs[displaySlot]) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs[displaySlot]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                    displaySize.x, displaySize.y,
+                    GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pboFences[displaySlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                    displaySize.x, displaySize.y,
+                    GL_RGBA, GL_UNSIGNED_BYTE,
+                    engine.FramePixels(displaySlot));
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // time to hand the upload to the driver, with pixel buffers the
+  // transfer itself happens asynchronously
+  HudRecord(engine.FrameStats(displaySlot),
+            std::chrono::duration<float>
+            (std::chrono::steady_clock::now() - t0).count());
+}
+
 // ======================================================================== //
 // Callback Functions
 // ======================================================================== //
-static GLuint texID;
-static GLuint fboID;
 void error_callback(int error, const char *description)
 {
   fprintf(stderr, "Error: %s\n", description);
@@ -245,6 +439,8 @@ void key_onpress_callback(GLFWwindow *window, int key,
     }
     if (key == GLFW_KEY_P && action == GLFW_PRESS) {
       tfnProp.Print();
+    } else if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+      hudShow = !hudShow;
     } else if (key == GLFW_KEY_V && action == GLFW_PRESS) {
       const auto vi = camera.CameraFocus();
       const auto vp = camera.CameraPos();
@@ -284,11 +480,13 @@ void window_size_callback(GLFWwindow *window, int width, int height)
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 
                0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
   glBindTexture(GL_TEXTURE_2D, 0);
-  // resize ospray objects
+  // resize ospray objects, the render thread must not write into the
+  // pixel buffers while they are replaced
   camera.CameraUpdateProj((size_t)width, (size_t)height);
+  engine.Stop();
   engine.Resize(width, height);
-  // resize screen buffer
-  displaybuffer.resize(camera.CameraWidth() * camera.CameraHeight());
+  CreatePixelBuffers(camera.CameraWidth(), camera.CameraHeight());
+  engine.Start();
 }
 
 // ======================================================================== //
@@ -297,7 +495,7 @@ void window_size_callback(GLFWwindow *window, int width, int height)
 void RenderWindow(GLFWwindow *window)
 {
   // Init
-  displaybuffer.resize(camera.CameraWidth() * camera.CameraHeight(), 0);
+  CreatePixelBuffers(camera.CameraWidth(), camera.CameraHeight());
   WidgetInit(window);
   // Start
   engine.Start();
@@ -305,27 +503,18 @@ void RenderWindow(GLFWwindow *window)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     {
       key_onhold_callback(window);
-      /* copy rendered buffer */
-      if (engine.HasNewFrame()) {
-        auto &mapped = engine.MapFramebuffer();
-        if (mapped.size() == displaybuffer.size()) {
-          auto *srcPixels = mapped.data();
-          auto *dstPixels = displaybuffer.data();
-          memcpy(dstPixels, srcPixels,
-                 displaybuffer.size() * sizeof(uint32_t));
-        }
-        engine.UnmapFramebuffer();
-      }
+      /* upload rendered buffer, if there is a new one */
+      UploadFrame();
       /* display buffer*/
       glBindTexture(GL_TEXTURE_2D, texID);
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 
-                      camera.CameraWidth(), camera.CameraHeight(), 
-                      GL_RGBA, GL_UNSIGNED_BYTE,
-                      displaybuffer.data());
       glBindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
-      glBlitFramebuffer(0, 0, camera.CameraWidth(), camera.CameraHeight(), 
-                        0, 0, camera.CameraWidth(), camera.CameraHeight(),
-                        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      {
+        const bool scaled = displaySize.x != camera.CameraWidth() ||
+                            displaySize.y != camera.CameraHeight();
+        glBlitFramebuffer(0, 0, displaySize.x, displaySize.y, 
+                          0, 0, camera.CameraWidth(), camera.CameraHeight(),
+                          GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+      }
       glBindTexture(GL_TEXTURE_2D, 0);
       /* draw widgets */
       WidgetDraw();
@@ -336,6 +525,7 @@ void RenderWindow(GLFWwindow *window)
   // ShutDown
   WidgetStop();
   engine.Stop();
+  DeletePixelBuffers();
   glfwDestroyWindow(window);
   glfwTerminate();
 }
@@ -370,6 +560,11 @@ GLFWwindow *CreateWindow()
   // Ready
   glfwMakeContextCurrent(window);
   gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+  if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4) ||
+      glfwExtensionSupported("GL_ARB_buffer_storage")) {
+    glBufferStorageFcn =
+      (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+  }
   glfwSwapInterval(1);
   check_error_gl("Ready");
   // Setup OpenGL
@@ -6,7 +6,9 @@
 #define OSPRAY_VIEWER_H
 
 #include "ospray/ospray.h"
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace viewer {
   int  Init(const int ac, const char** av,
@@ -21,6 +23,37 @@ namespace viewer {
   void Handler(OSPTransferFunction tfn, 
                const float& min, const float& max);
 
+  //! one implicit iso-surface the user can edit
+  struct IsoSurface {
+    float value;
+    osp::vec3f color;
+  };
+  //! 'rebuild' has to return a new, committed model showing the given
+  //! surfaces, or null when nothing changed. with 'background' it runs
+  //! on a thread of its own while rendering goes on, so it may only
+  //! create and commit new objects, never modify the ones being
+  //! rendered (this requires the local device). without, it runs on the
+  //! render thread between two frames. the viewer swaps the models once
+  //! it returns and releases the ones it got this way. 'recolor' sets
+  //! the color of one surface, it runs on the render thread and should
+  //! only update that surface's material. 'progress' is polled from the
+  //! ui thread and reports the extraction (leaves done of total, zero
+  //! total when not extracting)
+  void Handler(const std::vector<IsoSurface>& surfaces,
+               const float& min, const float& max,
+               std::function<OSPModel(const std::vector<IsoSurface>&)> rebuild,
+               std::function<void(size_t, const osp::vec3f&)> recolor,
+               std::function<void(uint64_t&, uint64_t&)> progress = nullptr,
+               bool background = true);
+
+  //! what the last (re)build of the scene cost, shown in the HUD
+  struct BuildStats {
+    double   extractTime{0.0};  //!< seconds extracting, all surfaces
+    double   bvhTime{0.0};      //!< seconds building the BVH
+    uint64_t activeVoxels{0};   //!< all surfaces
+  };
+  //! may be called from any thread, e.g. from a rebuild
+  void SetBuildStats(const BuildStats& stats);
 };
 
 #endif//OSPRAY_VIEWER_H
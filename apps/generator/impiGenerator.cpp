@@ -0,0 +1,601 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+//
+// Synthetic AMR dataset generator: writes a Chombo HDF5 file (in the
+// layout apps/bench/impiReader.cpp parses) plus an .osp file that can be
+// passed to the bench, so that loader, extraction and rendering can be
+// benchmarked at any scale without access to simulation data.
+//
+// Level 0 covers a cube of bricks, level l+1 refines the bricks of
+// level l with the largest value range of an analytic field. Bricks are
+// evaluated in parallel and streamed to disk in batches, so the output
+// size is only limited by the disk, not by memory.
+//
+// ======================================================================== //
+
+#include "../bench/impiHelper.h"
+
+#include "hdf5.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! same layout as the box3i compound the reader expects in level_i/boxes
+struct Box
+{
+  int lo[3];
+  int hi[3];
+};
+
+//! outputGhost attribute of level_i/data_attributes
+struct IntVect
+{
+  int v[3];
+};
+
+struct Level
+{
+  double dx;
+  std::vector<Box> boxes;
+};
+
+static std::string outName{"synthetic"};
+static std::string fieldName{"blobs"};
+static int numLevels{3};
+static int refineRatio{2};
+static int brickSize{16};
+static double targetCells{64.0 * 1024 * 1024};
+static float refineFraction{0.25f};
+static int rootCells{0}; // cells per axis of level 0, derived if 0
+static int numThreads{0};
+static unsigned int seed{0x1234};
+static bool dryRun{false};
+
+// ======================================================================== //
+// analytic fields, evaluated at positions in the unit cube and returning
+// values in [0,1]
+// ======================================================================== //
+
+struct Field
+{
+  virtual ~Field() = default;
+  virtual double operator()(double x, double y, double z) const = 0;
+};
+
+//! sum of gaussian blobs of random position, size and weight
+struct Blobs : public Field
+{
+  struct Blob { double c[3], invTwoSigma2, weight; };
+  std::vector<Blob> blobs;
+  Blobs(std::mt19937 &rng, const int n = 16)
+  {
+    std::uniform_real_distribution<double> pos(0.15, 0.85);
+    std::uniform_real_distribution<double> sigma(0.02, 0.1);
+    std::uniform_real_distribution<double> weight(0.5, 1.0);
+    for (int i = 0; i < n; ++i) {
+      const double s = sigma(rng);
+      blobs.push_back({{pos(rng), pos(rng), pos(rng)},
+                       1.0 / (2.0 * s * s), weight(rng)});
+    }
+  }
+  double operator()(double x, double y, double z) const override
+  {
+    double v = 0.0;
+    for (const auto &b : blobs) {
+      const double dx = x - b.c[0], dy = y - b.c[1], dz = z - b.c[2];
+      v += b.weight * std::exp(-(dx * dx + dy * dy + dz * dz) * b.invTwoSigma2);
+    }
+    return std::min(v, 1.0);
+  }
+};
+
+//! superposition of random plane waves with a kolmogorov-like spectrum
+//! (amplitude ~ k^-5/6 from wave number 2 to 64)
+struct Turbulence : public Field
+{
+  struct Wave { double k[3], phase, amplitude; };
+  std::vector<Wave> waves;
+  double norm{0.0};
+  Turbulence(std::mt19937 &rng, const int n = 32)
+  {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::normal_distribution<double> g(0.0, 1.0);
+    for (int i = 0; i < n; ++i) {
+      const double k = 2.0 * M_PI * 2.0 * std::pow(32.0, u(rng));
+      double d[3] = {g(rng), g(rng), g(rng)};
+      const double l = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      const double a = std::pow(k, -5.0 / 6.0);
+      waves.push_back({{k * d[0] / l, k * d[1] / l, k * d[2] / l},
+                       2.0 * M_PI * u(rng), a});
+      norm += a;
+    }
+  }
+  double operator()(double x, double y, double z) const override
+  {
+    double v = 0.0;
+    for (const auto &w : waves) {
+      v += w.amplitude * std::sin(w.k[0] * x + w.k[1] * y + w.k[2] * z + w.phase);
+    }
+    return 0.5 + 0.5 * v / norm;
+  }
+};
+
+//! a spherical blast wave: a thin, slightly perturbed shock front with a
+//! steep density ramp behind it and constant density ahead of it
+struct Shock : public Field
+{
+  double center[3], radius{0.35}, width{0.002};
+  double mode[3][3];
+  Shock(std::mt19937 &rng)
+  {
+    std::uniform_real_distribution<double> pos(0.45, 0.55);
+    std::uniform_real_distribution<double> u(0.0, 2.0 * M_PI);
+    for (int i = 0; i < 3; ++i) {
+      center[i] = pos(rng);
+      mode[i][0] = 3 + i * 2; // angular frequency
+      mode[i][1] = u(rng);    // phase
+      mode[i][2] = 0.02 / (i + 1);
+    }
+  }
+  double operator()(double x, double y, double z) const override
+  {
+    const double dx = x - center[0], dy = y - center[1], dz = z - center[2];
+    const double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+    const double theta = std::atan2(std::sqrt(dx * dx + dy * dy), dz);
+    const double phi = std::atan2(dy, dx);
+    double R = radius;
+    for (int i = 0; i < 3; ++i) {
+      R += radius * mode[i][2] *
+           std::sin(mode[i][0] * theta + mode[i][1]) *
+           std::cos(mode[i][0] * phi);
+    }
+    const double s = std::min(r / R, 1.0);
+    const double behind = 0.2 + 0.8 * s * s * s * s * s * s;
+    return 0.1 + 0.9 * behind * 0.5 * (1.0 - std::tanh((r - R) / width));
+  }
+};
+
+static Field *CreateField(std::mt19937 &rng)
+{
+  if (fieldName == "blobs")      return new Blobs(rng);
+  if (fieldName == "turbulence") return new Turbulence(rng);
+  if (fieldName == "shock")      return new Shock(rng);
+  throw std::runtime_error("unknown field '" + fieldName +
+                           "' (blobs, turbulence or shock)");
+}
+
+// ======================================================================== //
+// hierarchy
+// ======================================================================== //
+
+//! run 'fcn(i)' for i in [0,n) on all threads
+template <typename F> static void ParallelFor(const size_t n, const F &fcn)
+{
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (size_t i = next++; i < n; i = next++) fcn(i);
+    });
+  }
+  for (auto &t : threads) t.join();
+}
+
+//! value range of the field over a brick, estimated on 4^3 samples
+static double BrickRange(const Field &field, const Box &b,
+                         const double cellSize)
+{
+  double lo = 1.0, hi = 0.0;
+  for (int k = 0; k < 4; ++k)
+    for (int j = 0; j < 4; ++j)
+      for (int i = 0; i < 4; ++i) {
+        const int idx[3] = {i, j, k};
+        double p[3];
+        for (int d = 0; d < 3; ++d) {
+          const double t = idx[d] / 3.0;
+          p[d] = (b.lo[d] + t * (b.hi[d] + 1 - b.lo[d])) * cellSize;
+        }
+        const double v = field(p[0], p[1], p[2]);
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+      }
+  return hi - lo;
+}
+
+static std::vector<Level> BuildHierarchy(const Field &field)
+{
+  std::vector<Level> levels(numLevels);
+  const int n = rootCells / brickSize;
+  levels[0].dx = 1.0;
+  for (int z = 0; z < n; ++z)
+    for (int y = 0; y < n; ++y)
+      for (int x = 0; x < n; ++x) {
+        const int b[3] = {x, y, z};
+        Box box;
+        for (int d = 0; d < 3; ++d) {
+          box.lo[d] = b[d] * brickSize;
+          box.hi[d] = box.lo[d] + brickSize - 1;
+        }
+        levels[0].boxes.push_back(box);
+      }
+
+  for (int l = 1; l < numLevels; ++l) {
+    const Level &coarse = levels[l - 1];
+    Level &fine = levels[l];
+    fine.dx = coarse.dx / refineRatio;
+    const double cellSize = coarse.dx / rootCells;
+    std::vector<double> range(coarse.boxes.size());
+    ParallelFor(range.size(), [&](const size_t i) {
+      range[i] = BrickRange(field, coarse.boxes[i], cellSize);
+    });
+
+    // refine the given fraction of bricks with the largest value range,
+    // bricks without any variation are never refined
+    std::vector<size_t> order(range.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    const size_t count = std::min(
+      order.size(),
+      std::max<size_t>(1, size_t(std::ceil(refineFraction * order.size()))));
+    std::nth_element(order.begin(), order.begin() + (count - 1), order.end(),
+                     [&](size_t a, size_t b) { return range[a] > range[b]; });
+    order.resize(count);
+    std::sort(order.begin(), order.end());
+    for (const size_t i : order) {
+      if (range[i] <= 0.0) continue;
+      const Box &c = coarse.boxes[i];
+      for (int z = 0; z < refineRatio; ++z)
+        for (int y = 0; y < refineRatio; ++y)
+          for (int x = 0; x < refineRatio; ++x) {
+            const int b[3] = {x, y, z};
+            Box box;
+            for (int d = 0; d < 3; ++d) {
+              box.lo[d] = (c.lo[d] * refineRatio) + b[d] * brickSize;
+              box.hi[d] = box.lo[d] + brickSize - 1;
+            }
+            fine.boxes.push_back(box);
+          }
+    }
+    if (fine.boxes.empty()) {
+      std::cout << "#osp:generator: field is constant, stopping at "
+                << l << " levels" << std::endl;
+      levels.resize(l);
+      break;
+    }
+  }
+  return levels;
+}
+
+// ======================================================================== //
+// hdf5 output
+// ======================================================================== //
+
+static void WriteAttribute(hid_t loc, const char *name, hid_t type,
+                           const void *value)
+{
+  hid_t space = H5Screate(H5S_SCALAR);
+  hid_t attr = H5Acreate2(loc, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+  if (attr < 0 || H5Awrite(attr, type, value) < 0) {
+    throw std::runtime_error(std::string("cannot write attribute ") + name);
+  }
+  H5Aclose(attr);
+  H5Sclose(space);
+}
+
+static void WriteStringAttribute(hid_t loc, const char *name,
+                                 const std::string &value)
+{
+  hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, value.size());
+  WriteAttribute(loc, name, type, value.c_str());
+  H5Tclose(type);
+}
+
+static hid_t BoxType()
+{
+  hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Box));
+  H5Tinsert(type, "lo_i", HOFFSET(Box, lo[0]), H5T_NATIVE_INT);
+  H5Tinsert(type, "lo_j", HOFFSET(Box, lo[1]), H5T_NATIVE_INT);
+  H5Tinsert(type, "lo_k", HOFFSET(Box, lo[2]), H5T_NATIVE_INT);
+  H5Tinsert(type, "hi_i", HOFFSET(Box, hi[0]), H5T_NATIVE_INT);
+  H5Tinsert(type, "hi_j", HOFFSET(Box, hi[1]), H5T_NATIVE_INT);
+  H5Tinsert(type, "hi_k", HOFFSET(Box, hi[2]), H5T_NATIVE_INT);
+  return type;
+}
+
+static hid_t IntVectType()
+{
+  hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(IntVect));
+  H5Tinsert(type, "intvecti", HOFFSET(IntVect, v[0]), H5T_NATIVE_INT);
+  H5Tinsert(type, "intvectj", HOFFSET(IntVect, v[1]), H5T_NATIVE_INT);
+  H5Tinsert(type, "intvectk", HOFFSET(IntVect, v[2]), H5T_NATIVE_INT);
+  return type;
+}
+
+static hid_t CreateDataset(hid_t loc, const char *name, hid_t type,
+                           const hsize_t size)
+{
+  hid_t space = H5Screate_simple(1, &size, nullptr);
+  hid_t data = H5Dcreate2(loc, name, type, space,
+                          H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  H5Sclose(space);
+  if (data < 0) {
+    throw std::runtime_error(std::string("cannot create dataset ") + name);
+  }
+  return data;
+}
+
+static void WriteLevel(hid_t file, const int levelID, const Level &level,
+                       const Field &field)
+{
+  const std::string name = "level_" + std::to_string(levelID);
+  hid_t group = H5Gcreate2(file, name.c_str(),
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (group < 0) {
+    throw std::runtime_error("cannot create group " + name);
+  }
+  WriteAttribute(group, "dx", H5T_NATIVE_DOUBLE, &level.dx);
+  WriteAttribute(group, "ref_ratio", H5T_NATIVE_INT, &refineRatio);
+  hid_t boxType = BoxType();
+  {
+    int n = rootCells;
+    for (int l = 0; l < levelID; ++l) n *= refineRatio;
+    const Box domain = {{0, 0, 0}, {n - 1, n - 1, n - 1}};
+    WriteAttribute(group, "prob_domain", boxType, &domain);
+  }
+  {
+    hid_t attrs = H5Gcreate2(group, "data_attributes",
+                             H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const IntVect ghost = {{0, 0, 0}};
+    const int comps = 1;
+    hid_t ghostType = IntVectType();
+    WriteAttribute(attrs, "outputGhost", ghostType, &ghost);
+    WriteAttribute(attrs, "comps", H5T_NATIVE_INT, &comps);
+    H5Tclose(ghostType);
+    H5Gclose(attrs);
+  }
+
+  const size_t numBoxes = level.boxes.size();
+  const size_t brickVoxels = size_t(brickSize) * brickSize * brickSize;
+  {
+    hid_t boxes = CreateDataset(group, "boxes", boxType, numBoxes);
+    H5Dwrite(boxes, boxType, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+             level.boxes.data());
+    H5Dclose(boxes);
+  }
+  H5Tclose(boxType);
+  {
+    std::vector<int64_t> offsets(numBoxes + 1);
+    for (size_t i = 0; i <= numBoxes; ++i) offsets[i] = i * brickVoxels;
+    hid_t data = CreateDataset(group, "data:offsets=0", H5T_NATIVE_INT64,
+                               offsets.size());
+    H5Dwrite(data, H5T_NATIVE_INT64, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+             offsets.data());
+    H5Dclose(data);
+  }
+
+  // bricks are consecutive in the file, a batch of them is evaluated in
+  // parallel and written as one hyperslab. batches are ~256MB
+  hid_t data = CreateDataset(group, "data:datatype=0", H5T_NATIVE_DOUBLE,
+                             numBoxes * brickVoxels);
+  hid_t fileSpace = H5Dget_space(data);
+  const size_t batchBoxes =
+    std::max<size_t>(1, (size_t(256) << 20) / (brickVoxels * sizeof(double)));
+  std::vector<double> buffer(std::min(batchBoxes, numBoxes) * brickVoxels);
+  const double cellSize = level.dx / rootCells;
+  const auto t0 = ospray::impi::Time();
+  for (size_t first = 0; first < numBoxes; first += batchBoxes) {
+    const size_t count = std::min(batchBoxes, numBoxes - first);
+    ParallelFor(count, [&](const size_t i) {
+      const Box &b = level.boxes[first + i];
+      double *out = &buffer[i * brickVoxels];
+      for (int z = b.lo[2]; z <= b.hi[2]; ++z)
+        for (int y = b.lo[1]; y <= b.hi[1]; ++y)
+          for (int x = b.lo[0]; x <= b.hi[0]; ++x) {
+            *out++ = field((x + 0.5) * cellSize,
+                           (y + 0.5) * cellSize,
+                           (z + 0.5) * cellSize);
+          }
+    });
+    const hsize_t start = first * brickVoxels;
+    const hsize_t size = count * brickVoxels;
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &start, nullptr,
+                        &size, nullptr);
+    hid_t memSpace = H5Screate_simple(1, &size, nullptr);
+    if (H5Dwrite(data, H5T_NATIVE_DOUBLE, memSpace, fileSpace,
+                 H5P_DEFAULT, buffer.data()) < 0) {
+      throw std::runtime_error("cannot write data of " + name);
+    }
+    H5Sclose(memSpace);
+    std::cout << "\r#osp:generator: " << name << " "
+              << std::setw(3) << (100 * (first + count) / numBoxes) << "%"
+              << std::flush;
+  }
+  const double t = ospray::impi::Time(t0);
+  std::cout << " " << numBoxes << " bricks in " << t << "s ("
+            << numBoxes * brickVoxels * sizeof(double) / t / (1 << 20)
+            << " MB/s)" << std::endl;
+  H5Sclose(fileSpace);
+  H5Dclose(data);
+  H5Gclose(group);
+}
+
+static void WriteChombo(const std::string &fileName,
+                        const std::vector<Level> &levels,
+                        const Field &field)
+{
+  hid_t file = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC,
+                         H5P_DEFAULT, H5P_DEFAULT);
+  if (file < 0) {
+    throw std::runtime_error("cannot create " + fileName);
+  }
+  const int numComponents = 1;
+  const int levelCount = levels.size();
+  const int iteration = 0;
+  const double time = 0.0;
+  WriteAttribute(file, "num_components", H5T_NATIVE_INT, &numComponents);
+  WriteStringAttribute(file, "component_0", fieldName);
+  WriteAttribute(file, "num_levels", H5T_NATIVE_INT, &levelCount);
+  WriteAttribute(file, "iteration", H5T_NATIVE_INT, &iteration);
+  WriteAttribute(file, "time", H5T_NATIVE_DOUBLE, &time);
+  {
+    // the reader requires this to be the first object in the file,
+    // objects are listed by name, so it sorts before the levels
+    hid_t global = H5Gcreate2(file, "Chombo_global",
+                              H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const int spaceDim = 3;
+    WriteAttribute(global, "SpaceDim", H5T_NATIVE_INT, &spaceDim);
+    H5Gclose(global);
+  }
+  for (size_t l = 0; l < levels.size(); ++l) {
+    WriteLevel(file, l, levels[l], field);
+  }
+  H5Fclose(file);
+}
+
+static void WriteOsp(const std::string &fileName, const std::string &hdf5)
+{
+  std::ofstream os(fileName);
+  if (!os) {
+    throw std::runtime_error("cannot create " + fileName);
+  }
+  // the hdf5 file name is relative to the .osp file
+  const size_t slash = hdf5.find_last_of('/');
+  os << "<?xml?>\n"
+     << "<ospray>\n"
+     << "<AMRVolume\n"
+     << "\tfileName=\""
+     << (slash == std::string::npos ? hdf5 : hdf5.substr(slash + 1)) << "\"\n"
+     << "\tmethod=\"current\"\n"
+     << "\t/>\n"
+     << "</ospray>\n";
+}
+
+//! parse a cell count with an optional k/M/G/T suffix (powers of 1024)
+static double ParseCount(const std::string &str)
+{
+  char *end = nullptr;
+  double v = std::strtod(str.c_str(), &end);
+  // each suffix is another factor of 1024
+  static const char suffixes[] = "kmgt";
+  for (int p = 0; *end && suffixes[p]; ++p) {
+    if (std::tolower((unsigned char)*end) == suffixes[p]) {
+      v *= std::pow(1024.0, p + 1);
+      ++end;
+      break;
+    }
+  }
+  if (end == str.c_str() || *end != '\0' || v <= 0.0) {
+    throw std::runtime_error("bad cell count " + str);
+  }
+  return v;
+}
+
+int main(int ac, const char **av)
+{
+  for (int i = 1; i < ac; ++i) {
+    std::string str(av[i]);
+    if (str == "-o") {
+      if (i + 1 >= ac) throw std::runtime_error("value required for -o");
+      outName = av[++i];
+    } else if (str == "-field") {
+      if (i + 1 >= ac) throw std::runtime_error("value required for -field");
+      fieldName = av[++i];
+    } else if (str == "-levels") {
+      ospray::impi::Parse<1>(ac, av, i, numLevels);
+    } else if (str == "-ratio") {
+      ospray::impi::Parse<1>(ac, av, i, refineRatio);
+    } else if (str == "-brick") {
+      ospray::impi::Parse<1>(ac, av, i, brickSize);
+    } else if (str == "-cells") {
+      if (i + 1 >= ac) throw std::runtime_error("value required for -cells");
+      targetCells = ParseCount(av[++i]);
+    } else if (str == "-root") {
+      ospray::impi::Parse<1>(ac, av, i, rootCells);
+    } else if (str == "-refine") {
+      ospray::impi::Parse<1>(ac, av, i, refineFraction);
+    } else if (str == "-threads") {
+      ospray::impi::Parse<1>(ac, av, i, numThreads);
+    } else if (str == "-seed") {
+      int s = 0;
+      ospray::impi::Parse<1>(ac, av, i, s);
+      seed = s;
+    } else if (str == "-dry-run") {
+      dryRun = true;
+    } else {
+      throw std::runtime_error("unknown argument: " + str +
+                               " (options: -o <name> -field <blobs|"
+                               "turbulence|shock> -levels <n> -ratio <r>"
+                               " -brick <cells> -cells <total, e.g. 512M>"
+                               " -root <level 0 cells per axis>"
+                               " -refine <fraction> -threads <n>"
+                               " -seed <n> -dry-run)");
+    }
+  }
+  // the reader takes levels in the order of their names
+  if (numLevels < 1 || numLevels > 10) {
+    throw std::runtime_error("-levels must be in [1,10]");
+  }
+  if (refineRatio < 2 || brickSize < 2) {
+    throw std::runtime_error("-ratio and -brick must be at least 2");
+  }
+  if (refineFraction <= 0.f || refineFraction > 1.f) {
+    throw std::runtime_error("-refine must be in (0,1]");
+  }
+  if (numThreads <= 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (rootCells <= 0) {
+    // every level adds refineFraction * ratio^3 times the cells of the
+    // previous one, pick the level 0 size that meets the target
+    const double growth = refineFraction * std::pow(refineRatio, 3);
+    double sum = 0.0;
+    for (int l = 0; l < numLevels; ++l) sum += std::pow(growth, l);
+    const double n = std::cbrt(targetCells / sum);
+    rootCells = std::max(1, int(std::round(n / brickSize))) * brickSize;
+  }
+  if (rootCells % brickSize) {
+    throw std::runtime_error("-root must be a multiple of -brick");
+  }
+
+  std::mt19937 rng(seed);
+  std::unique_ptr<Field> field(CreateField(rng));
+  auto t0 = ospray::impi::Time();
+  const auto levels = BuildHierarchy(*field);
+  const size_t brickVoxels = size_t(brickSize) * brickSize * brickSize;
+  size_t totalCells = 0;
+  for (size_t l = 0; l < levels.size(); ++l) {
+    const size_t cells = levels[l].boxes.size() * brickVoxels;
+    totalCells += cells;
+    std::cout << "#osp:generator: level " << l << ": dx " << levels[l].dx
+              << ", " << levels[l].boxes.size() << " bricks, " << cells
+              << " cells" << std::endl;
+  }
+  std::cout << "#osp:generator: " << fieldName << ", " << rootCells
+            << "^3 root cells, " << totalCells << " cells total, "
+            << std::setprecision(4)
+            << double(totalCells) * sizeof(double) / (1 << 30)
+            << " GB of data (hierarchy in " << ospray::impi::Time(t0)
+            << "s)" << std::endl;
+  if (dryRun) return 0;
+
+  const std::string hdf5 = outName + ".hdf5";
+  t0 = ospray::impi::Time();
+  WriteChombo(hdf5, levels, *field);
+  WriteOsp(outName + ".osp", hdf5);
+  std::cout << "#osp:generator: wrote " << hdf5 << " and " << outName
+            << ".osp in " << ospray::impi::Time(t0) << "s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,311 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+//
+// Ray-voxel intersection microbenchmark: runs the kernels of
+// ospray/geometry/Voxel.ih (actualVoxelIntersect with the cubic
+// polynomial and the bezier root solver) on synthetic voxels outside of
+// any renderer, and reports rays*voxels/s, hit rate and root solver
+// iterations for every ISPC target compiled into this binary.
+//
+// ======================================================================== //
+
+#include "ospcommon/vec.h"
+#include "../bench/impiHelper.h"
+#include "impiMicroBench_ispc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// ispc appends the target name to exported functions when compiling
+// for multiple targets, the dispatcher without suffix picks the best
+// one for the cpu. the per-target entry points are declared weak so
+// that single target builds (which only have the dispatcher) still link
+extern "C" {
+#define MICROBENCH_TARGET(sfx)                                          \
+  int  microBench_width_##sfx() __attribute__((weak));                  \
+  void microBench_intersect_##sfx(const void *, uint32_t,               \
+                                  const float *, const float *,         \
+                                  uint32_t, float, bool,                \
+                                  uint64_t &, uint64_t &)               \
+    __attribute__((weak));
+  MICROBENCH_TARGET(sse4)
+  MICROBENCH_TARGET(avx)
+  MICROBENCH_TARGET(avx2)
+  MICROBENCH_TARGET(avx512knl)
+  MICROBENCH_TARGET(avx512skx)
+#undef MICROBENCH_TARGET
+}
+
+//! same memory layout as Voxel in Voxel.ih and Impi::Voxel
+struct Voxel
+{
+  float vtx[2][2][2];
+  float lower[3]; int align0;
+  float upper[3]; int align1;
+};
+
+struct Target
+{
+  std::string name;
+  bool supported;
+  int (*width)();
+  void (*intersect)(const void *, uint32_t, const float *, const float *,
+                    uint32_t, float, bool, uint64_t &, uint64_t &);
+};
+
+static int numVoxels{4096};
+static int raysPerVoxel{256};
+static int numRepeats{5};
+static bool coherentRays{false};
+static float isoValue{0.5f};
+static bool userIsoValue{false};
+static unsigned int seed{0x1234};
+static std::string rawFile;
+static ospcommon::vec3i rawDims{0, 0, 0};
+
+//! voxels with uniformly random corner values in [0,1] and random
+//! (unit-ish) sizes, for iso-value 0.5
+static std::vector<Voxel> RandomVoxels(std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> value(0.f, 1.f);
+  std::uniform_real_distribution<float> size(0.5f, 2.f);
+  std::vector<Voxel> voxels(numVoxels);
+  for (auto &v : voxels) {
+    float *vtx = &v.vtx[0][0][0];
+    // make sure the iso-value lies within the corner range, like for
+    // all voxels the active voxel extraction would produce
+    float lo, hi;
+    do {
+      for (int i = 0; i < 8; ++i) vtx[i] = value(rng);
+      lo = *std::min_element(vtx, vtx + 8);
+      hi = *std::max_element(vtx, vtx + 8);
+    } while (isoValue < lo || isoValue > hi);
+    const float w = size(rng);
+    for (int k = 0; k < 3; ++k) {
+      v.lower[k] = value(rng) * 16.f;
+      v.upper[k] = v.lower[k] + w;
+    }
+    v.align0 = v.align1 = 0;
+  }
+  return voxels;
+}
+
+//! active voxels of a vertex-centered float volume (e.g.
+//! data/density_064_064_2.0.raw), randomly subsampled
+static std::vector<Voxel> VolumeVoxels(std::mt19937 &rng)
+{
+  const size_t nx = rawDims.x, ny = rawDims.y, nz = rawDims.z;
+  std::vector<float> data(nx * ny * nz);
+  std::ifstream is(rawFile, std::ios::binary);
+  if (!is.read((char *)data.data(), data.size() * sizeof(float))) {
+    throw std::runtime_error("cannot read " + std::to_string(data.size()) +
+                             " floats from " + rawFile);
+  }
+  if (!userIsoValue) {
+    const auto mm = std::minmax_element(data.begin(), data.end());
+    isoValue = 0.5f * (*mm.first + *mm.second);
+  }
+  auto at = [&](size_t x, size_t y, size_t z) {
+    return data[x + nx * (y + ny * z)];
+  };
+  std::vector<Voxel> active;
+  for (size_t z = 0; z + 1 < nz; ++z)
+    for (size_t y = 0; y + 1 < ny; ++y)
+      for (size_t x = 0; x + 1 < nx; ++x) {
+        Voxel v;
+        float lo = at(x, y, z), hi = lo;
+        for (int k = 0; k < 2; ++k)
+          for (int j = 0; j < 2; ++j)
+            for (int i = 0; i < 2; ++i) {
+              const float f = at(x + i, y + j, z + k);
+              v.vtx[k][j][i] = f;
+              lo = std::min(lo, f);
+              hi = std::max(hi, f);
+            }
+        if (isoValue < lo || isoValue > hi) continue;
+        v.lower[0] = x;     v.lower[1] = y;     v.lower[2] = z;
+        v.upper[0] = x + 1; v.upper[1] = y + 1; v.upper[2] = z + 1;
+        v.align0 = v.align1 = 0;
+        active.push_back(v);
+      }
+  if (active.empty()) {
+    throw std::runtime_error("no active voxels in " + rawFile);
+  }
+  std::cout << "#osp:microbench: " << active.size() << " active voxels in "
+            << rawFile << " for iso-value " << isoValue << std::endl;
+  std::shuffle(active.begin(), active.end(), rng);
+  if (active.size() > (size_t)numVoxels) active.resize(numVoxels);
+  numVoxels = active.size();
+  return active;
+}
+
+//! rays aimed at each voxel. random rays start on a sphere around the
+//! voxel and go through a random point inside it; coherent rays form a
+//! parallel (orthographic) grid along one random direction, so that
+//! neighbouring lanes trace neighbouring rays
+static void GenerateRays(const std::vector<Voxel> &voxels,
+                         std::mt19937 &rng,
+                         std::vector<float> &org,
+                         std::vector<float> &dir)
+{
+  using namespace ospcommon;
+  std::uniform_real_distribution<float> u01(0.f, 1.f);
+  auto randomDir = [&]() {
+    const float z = 2.f * u01(rng) - 1.f;
+    const float a = 2.f * float(M_PI) * u01(rng);
+    const float r = std::sqrt(std::max(0.f, 1.f - z * z));
+    return vec3f(r * std::cos(a), r * std::sin(a), z);
+  };
+  org.resize(3 * voxels.size() * raysPerVoxel);
+  dir.resize(3 * voxels.size() * raysPerVoxel);
+  const int side = std::max(1, (int)std::sqrt((float)raysPerVoxel));
+  for (size_t v = 0; v < voxels.size(); ++v) {
+    const vec3f lo(voxels[v].lower[0], voxels[v].lower[1], voxels[v].lower[2]);
+    const vec3f hi(voxels[v].upper[0], voxels[v].upper[1], voxels[v].upper[2]);
+    const vec3f center = 0.5f * (lo + hi);
+    const float radius = length(hi - lo);
+    // coherent: one direction and an orthonormal frame per voxel
+    const vec3f d = randomDir();
+    const vec3f du = normalize(cross(d, std::abs(d.x) < .9f ?
+                                     vec3f(1,0,0) : vec3f(0,1,0)));
+    const vec3f dv = cross(d, du);
+    for (int r = 0; r < raysPerVoxel; ++r) {
+      vec3f o, dd;
+      if (coherentRays) {
+        const float s = ((r % side) + .5f) / side - .5f;
+        const float t = ((r / side % side) + .5f) / side - .5f;
+        o  = center - 2.f * radius * d + radius * (s * du + t * dv);
+        dd = d;
+      } else {
+        o = center + 2.f * radius * randomDir();
+        const vec3f p(lo.x + u01(rng) * (hi.x - lo.x),
+                      lo.y + u01(rng) * (hi.y - lo.y),
+                      lo.z + u01(rng) * (hi.z - lo.z));
+        dd = normalize(p - o);
+      }
+      const size_t i = 3 * (v * raysPerVoxel + r);
+      org[i + 0] = o.x;  org[i + 1] = o.y;  org[i + 2] = o.z;
+      dir[i + 0] = dd.x; dir[i + 1] = dd.y; dir[i + 2] = dd.z;
+    }
+  }
+}
+
+int main(int ac, const char **av)
+{
+  for (int i = 1; i < ac; ++i) {
+    std::string str(av[i]);
+    if (str == "-voxels") {
+      ospray::impi::Parse<1>(ac, av, i, numVoxels);
+    } else if (str == "-rays") {
+      ospray::impi::Parse<1>(ac, av, i, raysPerVoxel);
+    } else if (str == "-repeat") {
+      ospray::impi::Parse<1>(ac, av, i, numRepeats);
+    } else if (str == "-iso") {
+      ospray::impi::Parse<1>(ac, av, i, isoValue);
+      userIsoValue = true;
+    } else if (str == "-seed") {
+      int s = 0;
+      ospray::impi::Parse<1>(ac, av, i, s);
+      seed = s;
+    } else if (str == "-coherent") {
+      coherentRays = true;
+    } else if (str == "-raw") {
+      try {
+        if (i + 1 >= ac) throw std::runtime_error("missing file name");
+        rawFile = av[++i];
+        ospray::impi::Parse<3>(ac, av, i, rawDims);
+      } catch (const std::runtime_error &e) {
+        throw std::runtime_error(std::string(e.what()) +
+                                 " usage: -raw <float32 file> <nx> <ny> <nz>");
+      }
+    } else {
+      throw std::runtime_error("unknown argument: " + str +
+                               " (options: -voxels <n> -rays <n per voxel>"
+                               " -repeat <n> -iso <v> -seed <n> -coherent"
+                               " -raw <file> <nx> <ny> <nz>)");
+    }
+  }
+  if (numVoxels <= 0 || raysPerVoxel <= 0 || numRepeats <= 0) {
+    throw std::runtime_error("-voxels, -rays and -repeat must be positive");
+  }
+
+  std::mt19937 rng(seed);
+  const auto voxels = rawFile.empty() ? RandomVoxels(rng) : VolumeVoxels(rng);
+  std::vector<float> org, dir;
+  GenerateRays(voxels, rng, org, dir);
+  const double tests = double(voxels.size()) * raysPerVoxel;
+  std::cout << "#osp:microbench: " << voxels.size() << " "
+            << (rawFile.empty() ? "random" : "volume") << " voxels x "
+            << raysPerVoxel << " " << (coherentRays ? "coherent" : "random")
+            << " rays, iso-value " << isoValue << std::endl;
+
+  // one entry per compiled target, plus the dispatcher as fallback
+  std::vector<Target> targets = {
+    {"sse4",      (bool)__builtin_cpu_supports("sse4.2"),
+     microBench_width_sse4, microBench_intersect_sse4},
+    {"avx",       (bool)__builtin_cpu_supports("avx"),
+     microBench_width_avx, microBench_intersect_avx},
+    {"avx2",      (bool)__builtin_cpu_supports("avx2"),
+     microBench_width_avx2, microBench_intersect_avx2},
+    {"avx512knl", (bool)__builtin_cpu_supports("avx512er"),
+     microBench_width_avx512knl, microBench_intersect_avx512knl},
+    {"avx512skx", (bool)__builtin_cpu_supports("avx512bw"),
+     microBench_width_avx512skx, microBench_intersect_avx512skx},
+  };
+  targets.erase(std::remove_if(targets.begin(), targets.end(),
+                               [](const Target &t) {
+                                 return !t.intersect || !t.width;
+                               }),
+                targets.end());
+  if (targets.empty()) {
+    targets.push_back({"default", true,
+                       [](){ return (int)ispc::microBench_width(); },
+                       [](const void *v, uint32_t nv, const float *o,
+                          const float *d, uint32_t nr, float iso, bool bz,
+                          uint64_t &h, uint64_t &it) {
+                         ispc::microBench_intersect(v, nv, o, d, nr, iso, bz,
+                                                    h, it);
+                       }});
+  }
+
+  std::cout << std::left << std::setw(11) << "target" << std::setw(7)
+            << "width" << std::setw(8) << "solver" << std::setw(16)
+            << "rays*voxels/s" << std::setw(10) << "hit rate"
+            << std::setw(16) << "iterations/ray" << "iterations/hit"
+            << std::endl;
+  for (const auto &t : targets) {
+    if (!t.supported) {
+      std::cout << std::setw(11) << t.name << "not supported by this cpu"
+                << std::endl;
+      continue;
+    }
+    for (const bool bezier : {false, true}) {
+      uint64_t hits = 0, iterations = 0;
+      // untimed run to warm up caches
+      t.intersect(voxels.data(), voxels.size(), org.data(), dir.data(),
+                  raysPerVoxel, isoValue, bezier, hits, iterations);
+      double best = std::numeric_limits<double>::infinity();
+      for (int r = 0; r < numRepeats; ++r) {
+        const auto t0 = ospray::impi::Time();
+        t.intersect(voxels.data(), voxels.size(), org.data(), dir.data(),
+                    raysPerVoxel, isoValue, bezier, hits, iterations);
+        best = std::min(best, ospray::impi::Time(t0));
+      }
+      std::cout << std::setw(11) << t.name << std::setw(7) << t.width()
+                << std::setw(8) << (bezier ? "bezier" : "poly3")
+                << std::setw(16) << std::setprecision(4) << tests / best
+                << std::setw(10) << hits / tests
+                << std::setw(16) << iterations / tests
+                << (hits ? double(iterations) / hits : 0.0) << std::endl;
+    }
+  }
+  return 0;
+}
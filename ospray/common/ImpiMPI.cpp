@@ -0,0 +1,154 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#include "ImpiMPI.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#ifdef IMPI_MPI
+# include "mpiCommon/MPICommon.h"
+#endif
+
+namespace ospray {
+  namespace impi {
+    namespace mpi {
+
+#ifdef IMPI_MPI
+      /*! a copy of the workers' communicator, so that our collectives
+          never interleave with the messages of the mpi device */
+      static MPI_Comm comm()
+      {
+        static MPI_Comm c = [] {
+          MPI_Comm dup = MPI_COMM_NULL;
+          int initialized = 0;
+          MPI_Initialized(&initialized);
+          const char *env = getenv("IMPI_MPI_EXTRACT");
+          if (initialized && !(env && strcmp(env, "0") == 0) &&
+              mpicommon::worker.comm != MPI_COMM_NULL &&
+              mpicommon::worker.size > 1) {
+            MPI_Comm_dup(mpicommon::worker.comm, &dup);
+          }
+          return dup;
+        }();
+        return c;
+      }
+
+      bool enabled()
+      {
+        return comm() != MPI_COMM_NULL;
+      }
+
+      int rank()
+      {
+        int r = 0;
+        if (enabled())
+          MPI_Comm_rank(comm(), &r);
+        return r;
+      }
+
+      int size()
+      {
+        int s = 1;
+        if (enabled())
+          MPI_Comm_size(comm(), &s);
+        return s;
+      }
+
+      void allgather(const void *local, size_t count, size_t itemBytes,
+                     const std::function<void *(size_t)> &alloc)
+      {
+        if (!enabled()) {
+          void *all = alloc(count);
+          if (count)
+            memcpy(all, local, count * itemBytes);
+          return;
+        }
+        const int n = size();
+        // counts and displacements are in items, so that the byte
+        // size of the whole list may exceed what an int can hold. the
+        // item count of the whole list has to fit, a count that does
+        // not is sent as -1 so that all workers fail together instead
+        // of waiting for this one
+        const size_t maxItems = size_t(std::numeric_limits<int>::max());
+        int mine = count > maxItems ? -1 : (int)count;
+        std::vector<int> counts(n), displs(n);
+        MPI_Allgather(&mine, 1, MPI_INT, counts.data(), 1, MPI_INT, comm());
+        size_t total = 0;
+        for (int r = 0; r < n; ++r) {
+          if (counts[r] < 0)
+            throw std::runtime_error("#osp:impi: too many voxels to gather");
+          displs[r] = (int)total;
+          total += counts[r];
+          if (total > maxItems)
+            throw std::runtime_error("#osp:impi: too many voxels to gather");
+        }
+        MPI_Datatype item;
+        MPI_Type_contiguous((int)itemBytes, MPI_BYTE, &item);
+        MPI_Type_commit(&item);
+        void *all = alloc(total);
+        MPI_Allgatherv(local, mine, item,
+                       all, counts.data(), displs.data(), item, comm());
+        MPI_Type_free(&item);
+        printf("#osp:impi: worker %d/%d extracted %zu of %zu voxels\n",
+               rank(), n, count, total);
+      }
+#else
+      bool enabled() { return false; }
+      int rank() { return 0; }
+      int size() { return 1; }
+
+      void allgather(const void *local, size_t count, size_t itemBytes,
+                     const std::function<void *(size_t)> &alloc)
+      {
+        void *all = alloc(count);
+        if (count)
+          memcpy(all, local, count * itemBytes);
+      }
+#endif
+
+      void partition(const std::vector<size_t> &weights,
+                     size_t &begin, size_t &end)
+      {
+        begin = 0;
+        end   = weights.size();
+        const int n = size();
+        if (n <= 1)
+          return;
+        size_t total = 0;
+        for (const size_t w : weights)
+          total += w;
+        if (total == 0)
+          total = 1;
+        // an item goes to the worker its middle falls on
+        const int r = rank();
+        size_t before = 0;
+        bool started = false;
+        for (size_t i = 0; i < weights.size(); ++i) {
+          const double middle = before + 0.5 * weights[i];
+          const int owner =
+              std::min(n - 1, int(middle * n / double(total)));
+          before += weights[i];
+          if (owner < r) {
+            continue;
+          } else if (owner == r && !started) {
+            begin = i;
+            started = true;
+          } else if (owner > r) {
+            end = i;
+            break;
+          }
+        }
+        if (!started)
+          begin = end;
+      }
+
+    } // ::ospray::impi::mpi
+  } // ::ospray::impi
+} // ::ospray
@@ -0,0 +1,63 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ospray/common/ImpiMPI.h Extraction split across the workers of
+  the ospray mpi device (mpirun ... --osp:mpi).
+
+  Every worker holds the whole AMR volume and builds its own BVH over
+  all active voxels, but each one only extracts a contiguous share of
+  the AMR leaves, balanced by their number of octants, and the shares
+  are then all-gathered in rank order. The result is the same list of
+  voxels (in the same order) as a single process extracts.
+
+  Only compiled in with IMPI_MPI (the module is built against ospray's
+  mpi module), and only active with more than one worker.
+  IMPI_MPI_EXTRACT=0 makes every worker extract everything, to compare
+  against. */
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+    namespace mpi {
+
+      /*! true if extraction is split across more than one worker */
+      bool enabled();
+      /*! this worker and the number of workers (0 and 1 if disabled) */
+      int rank();
+      int size();
+
+      /*! the items [begin,end) this worker extracts: contiguous, with
+          about the same sum of 'weights' on every worker. all of them
+          if disabled */
+      void partition(const std::vector<size_t> &weights,
+                     size_t &begin, size_t &end);
+
+      /*! concatenate the 'count' items of 'itemBytes' at 'local' of all
+          workers in rank order, into the memory 'alloc' returns for
+          the total number of items. must be called by all workers */
+      void allgather(const void *local, size_t count, size_t itemBytes,
+                     const std::function<void *(size_t)> &alloc);
+
+      /*! replace the items of this worker by those of all workers */
+      template <typename T>
+      inline void allgather(std::vector<T> &items)
+      {
+        if (!enabled())
+          return;
+        std::vector<T> local;
+        local.swap(items);
+        allgather(local.data(), local.size(), sizeof(T), [&](size_t n) {
+          items.resize(n);
+          return (void *)items.data();
+        });
+      }
+
+    } // ::ospray::impi::mpi
+  } // ::ospray::impi
+} // ::ospray
@@ -0,0 +1,119 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#include "ImpiStats.h"
+
+#include <embree3/rtcore.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*! ospray's embree device (see ospray/api/ISPCDevice.cpp) */
+extern "C" RTCDevice ispc_embreeDevice();
+
+namespace ospray {
+  namespace impi {
+
+    static std::mutex             statsMutex;
+    static std::vector<ImpiStats> statsRecords;
+
+    void recordStats(const ImpiStats &stats)
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      statsRecords.push_back(stats);
+    }
+
+    static std::atomic<int64_t> embreeBytes{0};
+    static std::atomic<int64_t> embreePeakBytes{0};
+
+    /*! called by embree before every allocation (bytes > 0) and after
+        every free (bytes < 0) */
+    static bool embreeMemoryMonitor(void *, ssize_t bytes, bool)
+    {
+      const int64_t now = embreeBytes += bytes;
+      int64_t peak = embreePeakBytes.load();
+      while (now > peak && !embreePeakBytes.compare_exchange_weak(peak, now))
+        ;
+      return true;
+    }
+
+    void installEmbreeMemoryMonitor()
+    {
+      static std::mutex installMutex;
+      static bool installed = false;
+      std::lock_guard<std::mutex> lock(installMutex);
+      if (installed)
+        return;
+      RTCDevice device = ispc_embreeDevice();
+      if (device) {
+        rtcSetDeviceMemoryMonitorFunction(
+            device, embreeMemoryMonitor, nullptr);
+        installed = true;
+      }
+    }
+
+    extern "C" void ospray_impi_embree_memory(int64_t *current,
+                                              int64_t *peak,
+                                              int resetPeak)
+    {
+      if (current)
+        *current = embreeBytes.load();
+      if (peak)
+        *peak = embreePeakBytes.load();
+      if (resetPeak)
+        embreePeakBytes = embreeBytes.load();
+    }
+
+    static std::atomic<uint64_t> progressDone{0};
+    static std::atomic<uint64_t> progressTotal{0};
+
+    void beginProgress(uint64_t total)
+    {
+      progressDone  = 0;
+      progressTotal = total;
+    }
+
+    void advanceProgress()
+    {
+      ++progressDone;
+    }
+
+    void endProgress()
+    {
+      progressTotal = 0;
+      progressDone  = 0;
+    }
+
+    extern "C" void ospray_impi_progress(uint64_t *done, uint64_t *total)
+    {
+      if (done)
+        *done = progressDone.load();
+      if (total)
+        *total = progressTotal.load();
+    }
+
+    extern "C" size_t ospray_impi_stats_count()
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      return statsRecords.size();
+    }
+
+    extern "C" int ospray_impi_stats_get(size_t i, ImpiStats *out)
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      if (out == nullptr || i >= statsRecords.size())
+        return 0;
+      *out = statsRecords[i];
+      return 1;
+    }
+
+    extern "C" void ospray_impi_stats_clear()
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      statsRecords.clear();
+    }
+
+  } // ::ospray::impi
+} // ::ospray
@@ -0,0 +1,97 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ospray/common/ImpiStats.h Statistics the impi geometry
+  records every time it is finalized.
+
+  The records live inside the module library. Applications must not
+  link against the module (it gets loaded through ospLoadModule), so
+  the records are read back through the plain extern "C" accessors
+  declared below, which an application resolves by name with
+  ospcommon::getSymbol() -- the same way ospray itself finds the
+  module's init function. This only works when the module lives in
+  the application's address space (i.e. local device); with
+  --osp:mpi the records stay on the workers and the symbols cannot be
+  resolved. This header is deliberately free of any ospray includes
+  so that applications can include it as well. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*! one record per Impi::finalize */
+struct ImpiStats
+{
+  /*! the iso-value the geometry was finalized with */
+  float    isoValue;
+  /*! number of active voxels (== embree primitives) */
+  uint64_t numActiveVoxels;
+  /*! seconds spent extracting active voxels (TestOctant::build and
+      getActiveVoxels), zero if the active set was reused because the
+      iso-value did not change */
+  double   extractTime;
+  /*! seconds spent in Impi::finalize in total (extraction plus
+      setting up the embree user geometry). The embree BVH itself is
+      built afterwards, when the model commits its scene */
+  double   finalizeTime;
+  /*! bytes held by the voxel source for the active set (the voxel
+      buffer for storage "active", zero for "none") */
+  uint64_t sourceBytes;
+  /*! bytes held by the list of active voxel references */
+  uint64_t refBytes;
+  /*! bytes of the per-leaf staging vectors during extraction, at
+      their peak (zero if the active set was reused) */
+  uint64_t stagingBytes;
+  /*! AMR leaves this geometry extracted, and how many of them reused
+      the previous timestep's active octants (see "temporalKey") */
+  uint64_t numLeaves;
+  uint64_t reusedLeaves;
+};
+
+#define IMPI_STATS_COUNT_FCN "ospray_impi_stats_count"
+#define IMPI_STATS_GET_FCN   "ospray_impi_stats_get"
+#define IMPI_STATS_CLEAR_FCN "ospray_impi_stats_clear"
+#define IMPI_EMBREE_MEMORY_FCN "ospray_impi_embree_memory"
+#define IMPI_PROGRESS_FCN      "ospray_impi_progress"
+
+/*! number of records since the last clear */
+typedef size_t (*ImpiStatsCountFcn)();
+/*! copy record 'i' into 'out', returns 0 if out of range */
+typedef int    (*ImpiStatsGetFcn)(size_t i, ImpiStats *out);
+/*! drop all records */
+typedef void   (*ImpiStatsClearFcn)();
+/*! bytes embree currently has allocated and the peak since the last
+    reset (if 'resetPeak' is set the peak restarts at the current
+    value). counting starts with the first impi finalize, both are
+    zero before that */
+typedef void   (*ImpiEmbreeMemoryFcn)(int64_t *current, int64_t *peak,
+                                      int resetPeak);
+/*! progress of the extraction running right now, in leaves of the AMR
+    accelerator: 'done' of 'total'. both are zero while no geometry is
+    extracting (e.g. while embree builds the BVH). may be called from
+    any thread, e.g. by a UI while another thread commits the model */
+typedef void   (*ImpiProgressFcn)(uint64_t *done, uint64_t *total);
+
+#ifdef __cplusplus
+namespace ospray {
+  namespace impi {
+
+    /*! append one record (thread safe) */
+    void recordStats(const ImpiStats &stats);
+
+    /*! install a memory monitor on ospray's embree device (once, as
+        soon as the device exists: at module init, so that embree's
+        allocations of other geometries are counted from the start) */
+    void installEmbreeMemoryMonitor();
+
+    /*! extraction progress (see ImpiProgressFcn): start counting up to
+        'total', count one more, and back to idle */
+    void beginProgress(uint64_t total);
+    void advanceProgress();
+    void endProgress();
+
+  } // ::ospray::impi
+} // ::ospray
+#endif
@@ -0,0 +1,216 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#include "ImpiTrace.h"
+
+#include <embree3/rtcore.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+    namespace trace {
+
+      struct Event
+      {
+        std::string name;
+        std::string category;
+        int64_t begin;
+        int64_t end;
+        const char *argName;
+        int64_t arg;
+      };
+
+      /*! events of one thread, appended to without locking */
+      struct ThreadBuffer
+      {
+        int tid;
+        std::vector<Event> events;
+      };
+
+      static std::mutex buffersMutex;
+      static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+      static ThreadBuffer &threadBuffer()
+      {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+          std::lock_guard<std::mutex> lock(buffersMutex);
+          buffers.emplace_back(new ThreadBuffer{int(buffers.size()), {}});
+          buffer = buffers.back().get();
+        }
+        return *buffer;
+      }
+
+      static const char *fileName()
+      {
+        static const char *name = getenv("IMPI_TRACE");
+        return name;
+      }
+
+      bool enabled()
+      {
+        static const bool on = fileName() && fileName()[0] != '\0';
+        return on;
+      }
+
+      int64_t now()
+      {
+        using namespace std::chrono;
+        static const steady_clock::time_point start = steady_clock::now();
+        return duration_cast<microseconds>(steady_clock::now() - start)
+            .count();
+      }
+
+      void event(const char *name, const char *category,
+                 int64_t begin, int64_t end,
+                 const char *argName, int64_t arg)
+      {
+        if (!enabled())
+          return;
+        threadBuffer().events.push_back(
+            {name, category, begin, end, argName, arg});
+      }
+
+      // embree calls the progress monitor of a scene from the threads
+      // building it, from 0 up to (usually) 1. the event spans the first
+      // to the last call
+      struct BuildMonitor
+      {
+        std::atomic<int64_t> begin{-1};
+        std::atomic<int64_t> last{-1};
+        void flush()
+        {
+          const int64_t b = begin.exchange(-1);
+          if (b >= 0)
+            event("embree build", "embree", b, last.load());
+        }
+      };
+
+      static std::mutex monitorsMutex;
+      static std::map<RTCScene, std::unique_ptr<BuildMonitor>> monitors;
+
+      static bool embreeBuildProgress(void *ptr, double n)
+      {
+        auto monitor = (BuildMonitor *)ptr;
+        const int64_t t = now();
+        int64_t unset = -1;
+        monitor->begin.compare_exchange_strong(unset, t);
+        monitor->last = t;
+        if (n >= 1.0)
+          monitor->flush();
+        return true;
+      }
+
+      void monitorEmbreeBuild(RTCScene scene)
+      {
+        if (!enabled() || !scene)
+          return;
+        std::lock_guard<std::mutex> lock(monitorsMutex);
+        auto &monitor = monitors[scene];
+        if (!monitor)
+          monitor.reset(new BuildMonitor);
+        // a build that never reported completion ends at its last call
+        monitor->flush();
+        rtcSetSceneProgressMonitorFunction(
+            scene, embreeBuildProgress, monitor.get());
+      }
+
+      static std::string quote(const std::string &s)
+      {
+        std::string r = "\"";
+        for (const char c : s) {
+          if (c == '"' || c == '\\')
+            r += '\\';
+          if ((unsigned char)c >= 0x20)
+            r += c;
+        }
+        return r + "\"";
+      }
+
+      static bool write()
+      {
+        {
+          std::lock_guard<std::mutex> lock(monitorsMutex);
+          for (auto &m : monitors)
+            m.second->flush();
+        }
+        FILE *file = fopen(fileName(), "w");
+        if (!file) {
+          fprintf(stderr, "#osp:impi: cannot write trace %s\n", fileName());
+          return false;
+        }
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        size_t count = 0;
+        for (const auto &b : buffers) {
+          fprintf(file,
+                  "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+                  "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+                  first ? "" : ",\n", b->tid, b->tid);
+          first = false;
+          for (const auto &e : b->events) {
+            fprintf(file,
+                    ",\n{\"name\": %s, \"cat\": %s, \"ph\": \"X\", "
+                    "\"pid\": 0, \"tid\": %d, \"ts\": %lld, \"dur\": %lld",
+                    quote(e.name).c_str(), quote(e.category).c_str(), b->tid,
+                    (long long)e.begin, (long long)(e.end - e.begin));
+            if (e.argName)
+              fprintf(file, ", \"args\": {%s: %lld}",
+                      quote(e.argName).c_str(), (long long)e.arg);
+            fprintf(file, "}");
+          }
+          count += b->events.size();
+        }
+        fprintf(file, "\n]}\n");
+        const bool ok = fclose(file) == 0;
+        printf("#osp:impi: wrote %zu trace events to %s\n", count, fileName());
+        return ok;
+      }
+
+      /*! writes the trace when the module gets unloaded */
+      static struct WriteAtExit
+      {
+        ~WriteAtExit()
+        {
+          if (enabled())
+            write();
+        }
+      } writeAtExit;
+
+      extern "C" int ospray_impi_trace_enabled()
+      {
+        return enabled() ? 1 : 0;
+      }
+
+      extern "C" int64_t ospray_impi_trace_now()
+      {
+        return now();
+      }
+
+      extern "C" void ospray_impi_trace_event(const char *name,
+                                              const char *category,
+                                              int64_t begin,
+                                              int64_t end)
+      {
+        event(name, category, begin, end);
+      }
+
+      extern "C" int ospray_impi_trace_write()
+      {
+        return enabled() && write() ? 1 : 0;
+      }
+
+    } // ::ospray::impi::trace
+  } // ::ospray::impi
+} // ::ospray
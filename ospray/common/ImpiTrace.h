@@ -0,0 +1,81 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+/*! \file ospray/common/ImpiTrace.h Timeline of what the impi module
+  does, written in the Chrome trace event format (open it with
+  chrome://tracing or ui.perfetto.dev).
+
+  Tracing is off unless the environment variable IMPI_TRACE names the
+  output file. Events are collected in per-thread buffers and written
+  when the module is unloaded (at exit), or earlier if the application
+  calls the write function below. Like the records of ImpiStats.h the
+  extern "C" functions are meant to be resolved by name, so that
+  applications can add their own events (e.g. frames) to the same
+  timeline. */
+
+#include <stdint.h>
+
+#define IMPI_TRACE_ENABLED_FCN "ospray_impi_trace_enabled"
+#define IMPI_TRACE_NOW_FCN     "ospray_impi_trace_now"
+#define IMPI_TRACE_EVENT_FCN   "ospray_impi_trace_event"
+#define IMPI_TRACE_WRITE_FCN   "ospray_impi_trace_write"
+
+/*! non-zero if IMPI_TRACE is set */
+typedef int     (*ImpiTraceEnabledFcn)();
+/*! microseconds on the clock of the trace */
+typedef int64_t (*ImpiTraceNowFcn)();
+/*! add an event from 'begin' to 'end' (see ImpiTraceNowFcn) on the
+    calling thread, name and category are copied */
+typedef void    (*ImpiTraceEventFcn)(const char *name, const char *category,
+                                     int64_t begin, int64_t end);
+/*! write all events so far to the IMPI_TRACE file, returns 0 on
+    failure. must not be called while the module is working */
+typedef int     (*ImpiTraceWriteFcn)();
+
+#ifdef __cplusplus
+/* same as in embree3/rtcore_scene.h, without pulling in embree */
+typedef struct RTCSceneTy *RTCScene;
+
+namespace ospray {
+  namespace impi {
+    namespace trace {
+
+      bool enabled();
+      int64_t now();
+      /*! 'argName' must be a literal, it is not copied */
+      void event(const char *name, const char *category,
+                 int64_t begin, int64_t end,
+                 const char *argName = nullptr, int64_t arg = 0);
+
+      /*! an event covering the lifetime of this object */
+      struct Scope
+      {
+        Scope(const char *name, const char *category = "impi",
+              const char *argName = nullptr, int64_t arg = 0)
+            : name(name), category(category), argName(argName), arg(arg),
+              begin(enabled() ? now() : -1)
+        {
+        }
+        ~Scope()
+        {
+          if (begin >= 0)
+            event(name, category, begin, now(), argName, arg);
+        }
+        const char *name;
+        const char *category;
+        const char *argName;
+        int64_t arg;
+        int64_t begin;
+      };
+
+      /*! add an event for the next BVH build of 'scene', which embree
+          does once all geometries of a model are finalized */
+      void monitorEmbreeBuild(RTCScene scene);
+
+    } // ::ospray::impi::trace
+  } // ::ospray::impi
+} // ::ospray
+#endif
@@ -27,6 +27,8 @@
 #include "../voxelSources/structured/StructuredVolumeSource.h"
 #include "../voxelSources/structured/SegmentedVolumeSource.h"
 #include "ospray/volume/amr/AMRVolume.h"
+#include "../common/ImpiStats.h"
+#include "../common/ImpiTrace.h"
 
 // #include "../common/Volume.h"
 #include <limits>
@@ -74,6 +76,7 @@ namespace ospray {
       control points */
     void Impi::commit()
     {
+      trace::Scope scope("Impi::commit");
       PRINT(voxelSource);
       if (!voxelSource) {
         initVoxelSourceAndIsoValue();
@@ -86,6 +89,19 @@ namespace ospray {
       isoValue = getParam1f("isoValue", 0.7f);
       isoColor = getParam4f("isoColor", vec4f(1.0f));
       PRINT(isoColor);
+      attribute   = (Volume *)getParamObject("attributeDataPtr", nullptr);
+      attributeTF = (TransferFunction *)getParamObject(
+          "attributeTransferFunction", nullptr);
+      if (attribute && !attributeTF)
+        throw std::runtime_error("impi: attributeDataPtr needs an "
+                                 "attributeTransferFunction");
+      if (attribute && !std::dynamic_pointer_cast<testCase::TestOctant>(
+                           voxelSource))
+        throw std::runtime_error("impi: attributeDataPtr needs "
+                                 "voxelSource 'amr'");
+      if (attribute && !dynamic_cast<ospray::AMRVolume *>(attribute.ptr))
+        throw std::runtime_error("impi: attributeDataPtr must be an "
+                                 "amr_volume");
     }
 
     /*! ispc can't directly call virtual functions on the c++ side, so
@@ -111,23 +127,57 @@ namespace ospray {
     // Why this will work ???
     void Impi::finalize(Model *model)
     {
+      trace::Scope scope("Impi::finalize");
+      high_resolution_clock::time_point t0 = high_resolution_clock::now();
+
       Geometry::finalize(model);
 
+      ImpiStats stats{};
+      stats.isoValue = isoValue;
+      // only installs here if the module was loaded before ospray had
+      // an embree device, see ospray_init_module_impi
+      installEmbreeMemoryMonitor();
+
+      std::shared_ptr<testCase::TestOctant> testOct =
+          std::dynamic_pointer_cast<testCase::TestOctant>(voxelSource);
+
       // generate list of active voxels
       if (this->lastIsoValue != isoValue) {
-        std::shared_ptr<testCase::TestOctant> testOct =
-            std::dynamic_pointer_cast<testCase::TestOctant>(voxelSource);
-
         high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
-        testOct->build(isoValue);
-        voxelSource->getActiveVoxels(activeVoxelRefs, isoValue);
+        {
+          trace::Scope extract("Impi::extract");
+          if (testOct)
+            testOct->build(isoValue);
+          voxelSource->getActiveVoxels(activeVoxelRefs, isoValue);
+        }
 
         high_resolution_clock::time_point t2 = high_resolution_clock::now();
         duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
         printf("Build Active Octants Time: %.9fs \n", time_span.count());
+        stats.extractTime = time_span.count();
+        stats.stagingBytes = testOct ? testOct->stagingPeakBytes : 0;
+        stats.numLeaves    = testOct ? testOct->numLeaves : 0;
+        stats.reusedLeaves = testOct ? testOct->reusedLeaves : 0;
 
         this->lastIsoValue = isoValue;
+        cornersOf          = nullptr;
+      }
+
+      // values of the secondary field at the corners of the new voxels
+      if (!attribute) {
+        attributeCorners.clear();
+        attributeBounds.clear();
+        cornersOf = nullptr;
+      } else if (cornersOf != attribute.ptr) {
+        high_resolution_clock::time_point t1 = high_resolution_clock::now();
+        testOct->getCorners((const ospray::AMRVolume *)attribute.ptr,
+                            activeVoxelRefs, attributeCorners,
+                            attributeBounds);
+        cornersOf = attribute.ptr;
+        printf("Attribute Corners Time: %.9fs \n",
+               duration_cast<duration<double>>(high_resolution_clock::now() -
+                                               t1).count());
       }
 
       // and ask ispc side to build the voxels
@@ -137,53 +187,118 @@ namespace ospray {
                           activeVoxelRefs.size(),
                           (void *)this,
                           isoValue,
-                          (ispc::vec4f *)&isoColor);
+                          (ispc::vec4f *)&isoColor,
+                          attribute ? attributeCorners.data() : nullptr,
+                          attribute ? (ispc::vec4f *)attributeBounds.data()
+                                    : nullptr,
+                          attribute ? attributeTF->getIE() : nullptr);
+      // the BVH over the user geometry is built when the model commits
+      trace::monitorEmbreeBuild(model->embreeSceneHandle);
+
+      stats.numActiveVoxels = activeVoxelRefs.size();
+      if (testOct) {
+        stats.sourceBytes = testOct->storageBytes() +
+                            attributeCorners.capacity() * sizeof(float) +
+                            attributeBounds.capacity() * sizeof(vec4f);
+      } else if (auto grid = std::dynamic_pointer_cast
+                 <structured::StructuredVolumeSource>(voxelSource)) {
+        stats.sourceBytes = grid->storageBytes();
+      }
+      stats.refBytes =
+          activeVoxelRefs.capacity() * sizeof(VoxelSource::VoxelRef);
+      stats.finalizeTime = duration_cast<duration<double>>
+        (high_resolution_clock::now() - t0).count();
+      recordStats(stats);
     }
 
-    /*! create voxel source from whatever parameters we have been passed (right
-     * no, hardcoded) */
+    /*! create voxel source from the parameters we have been passed:
+      "voxelSource" picks the kind of source,
+
+      - "amr" (default): octants of the AMR volume "amrDataPtr",
+        optionally only those touching "clipBoxes". with a
+        "temporalKey" it reuses what the previous geometry with that
+        key extracted where the bricks did not change enough. with an
+        "attributeDataPtr" (an AMR volume of another component over the
+        same bricks) and an "attributeTransferFunction" the surface is
+        coloured by that component instead of "isoColor"
+      - "structured": a regular grid of "dimensions" float vertex
+        values in "voxelData", with the first vertex at "gridOrigin"
+        and "gridSpacing" between vertices (default: spanning a unit
+        cube). the values are not copied, the geometry keeps the data
+      - "segmented": same, restricted to the voxels that touch the
+        value "segment" in the grid "segmentData"
+
+      a structured source without "voxelData" is a blob test volume */
     void Impi::initVoxelSourceAndIsoValue()
     {
-      auto amr = (ospray::AMRVolume *)getParamObject("amrDataPtr", nullptr);
-      PRINT(amr->voxelRange);
-#if 0
-      isoValue = 20.f;
-      voxelSource = std::make_shared<testCase::TestVoxel>();
-#elif 1
       isoValue = getParam1f("isoValue", 0.7f);
       isoColor = getParam4f("isoColor", vec4f(1.0f));
-      voxelSource = std::make_shared<testCase::TestOctant>(amr, isoValue);
-#elif 0
-      /*! create a simple, amr-like data structure - just to test different-sized voxels right next to each other */
-      isoValue = 3.2f;
-      voxelSource = std::make_shared<testCase::TestAMR>();
-#elif 0
-      isoValue = 0.5f;
-      std::shared_ptr<structured::LogicalVolume> volume
-        = structured::createTestVolume(vec3i(64));
-      voxelSource = std::make_shared<structured::StructuredVolumeSource>(volume);
-#elif 0
-      std::shared_ptr<structured::LogicalVolume> volume;
-      const std::string fileName = "magnetic.raw";
-      try {
-        isoValue = 1.f;
-        std::cout << "loading test data set '" << fileName << "'" << std::endl;
-        volume  = structured::VolumeT<float>::loadRAW(fileName,vec3i(512));
-      } catch (std::runtime_error e) {
-        std::cout << "could not load '" << fileName << "' test file (reason: " << e.what() << "), using blob-testcase instead" << std::endl;
-        isoValue = 0.5f;
+      const std::string kind = getParamString("voxelSource", "amr");
+      if (kind == "amr") {
+        auto amr = (ospray::AMRVolume *)getParamObject("amrDataPtr", nullptr);
+        if (!amr)
+          throw std::runtime_error("impi: voxelSource 'amr' needs amrDataPtr");
+        PRINT(amr->voxelRange);
+        // "clipBoxes" (lower and upper corners, vec3f) limits the voxels
+        // to the region a data-parallel rank owns
+        std::vector<box3fa> clipBoxes;
+        if (Data *clip = getParamData("clipBoxes", nullptr)) {
+          if (clip->type != OSP_FLOAT3 || clip->numItems % 2)
+            throw std::runtime_error("impi: clipBoxes must be pairs of vec3f");
+          const vec3f *corner = (const vec3f *)clip->data;
+          for (size_t i = 0; i < clip->numItems; i += 2)
+            clipBoxes.push_back(box3fa(corner[i], corner[i + 1]));
+        }
+        // "amrStorage" (active/none) overrides IMPI_AMR_STORAGE, so that
+        // one process can hold geometries with different strategies
+        voxelSource = std::make_shared<testCase::TestOctant>(
+            amr, isoValue, getParamString("amrStorage", ""), clipBoxes,
+            getParamString("temporalKey", ""));
+        return;
+      }
+      if (kind != "structured" && kind != "segmented")
+        throw std::runtime_error("impi: unknown voxelSource '" + kind + "'");
+
+      const vec3i dims    = getParam3i("dimensions", vec3i(0));
+      const vec3f origin  = getParam3f("gridOrigin", vec3f(0.f));
+      // views of the app's values, which the sources index directly;
+      // the geometry keeps the data alive instead of copying it
+      auto grid = [&](const char *name, Ref<Data> &keep) {
+        Data *data = getParamData(name, nullptr);
+        if (!data)
+          return std::shared_ptr<structured::LogicalVolume>();
+        if (data->type != OSP_FLOAT || reduce_min(dims) < 2 ||
+            data->numItems != size_t(dims.x) * dims.y * dims.z)
+          throw std::runtime_error(std::string("impi: '") + name +
+                                   "' must hold 'dimensions' floats");
+        keep = data;
+        return structured::VolumeT<float>::wrap((float *)data->data, dims);
+      };
+      std::shared_ptr<structured::LogicalVolume> volume =
+          grid("voxelData", voxelData);
+      if (!volume) {
+        std::cout << "#osp:impi: no voxelData, using the blob test volume"
+                  << std::endl;
         volume = structured::createTestVolume(vec3i(64));
       }
-      voxelSource = std::make_shared<structured::StructuredVolumeSource>(volume);
-#else
-      isoValue = 20;
-      std::shared_ptr<structured::LogicalVolume> volume
-        = structured::VolumeT<float>::loadRAW("density_064_064_2.0.raw",vec3i(64));
-      std::shared_ptr<structured::LogicalVolume> segvol
-        = structured::VolumeT<float>::loadRAW("density_064_064_2.0_seg.raw",vec3i(64));
-      voxelSource = std::make_shared<structured::SegmentedVolumeSource>(volume,segvol,128);
-#endif
-    }        
+      // spanning a unit cube unless the app gave a spacing
+      vec3f spacing = getParam3f("gridSpacing", vec3f(0.f));
+      if (reduce_min(spacing) <= 0.f)
+        spacing = rcp(vec3f(volume->getDims()) - vec3f(1.f));
+      if (kind == "structured") {
+        voxelSource = std::make_shared<structured::StructuredVolumeSource>(
+            volume, origin, spacing);
+        return;
+      }
+      std::shared_ptr<structured::LogicalVolume> segVol =
+          grid("segmentData", segmentData);
+      if (!segVol || segVol->getDims() != volume->getDims())
+        throw std::runtime_error("impi: voxelSource 'segmented' needs "
+                                 "segmentData of the size of voxelData");
+      const int segment = getParam1i("segment", 0);
+      voxelSource = std::make_shared<structured::SegmentedVolumeSource>(
+          volume, segVol, segment, origin, spacing);
+    }
 
     /*! maybe one of the most important parts of this example: this
       macro 'registers' the Impi class under the ospray
@@ -27,6 +27,9 @@
 // ospray: everything that's related to the ospray ray tracing core
 #include <ospray/geometry/Geometry.h>
 #include <ospray/common/Model.h>
+#include <ospray/common/Data.h>
+#include <ospray/volume/Volume.h>
+#include <ospray/transferFunction/TransferFunction.h>
 
 // OUR includes
 // #include "../common/Volume.h"
@@ -81,8 +84,8 @@ namespace ospray {
           "ospCommit(<thisGeometry>)" */
       virtual void commit() override;
 
-      /*! create voxel source from whatever parameters we have been passed
-	(right no, hardcoded) */
+      /*! create voxel source from the parameters we have been passed
+	("voxelSource" and the parameters of that source) */
       void initVoxelSourceAndIsoValue();
 
       /*! 'finalize' is what ospray calls when everything is set and
@@ -94,12 +97,28 @@ namespace ospray {
 
       /*! the voxelsource that generates the actal voxels we need to intersect */
       std::shared_ptr<VoxelSource> voxelSource;
+      /*! the structured sources' values ("voxelData", "segmentData"),
+          which they only view */
+      Ref<Data> voxelData;
+      Ref<Data> segmentData;
 
       /*! the isovalue we're intersecting with */
       float isoValue;
       float lastIsoValue;
       vec4f isoColor;
 
+      /*! optional secondary field ("attributeDataPtr", an AMR volume
+          with the same bricks) that colours the surface through
+          "attributeTransferFunction" */
+      Ref<Volume> attribute;
+      Ref<TransferFunction> attributeTF;
+      /*! its values at the 8 corners of each active voxel, the lower
+          corner (xyz) and width (w) of each active voxel, and the
+          attribute they were computed for */
+      std::vector<float> attributeCorners;
+      std::vector<vec4f> attributeBounds;
+      const Volume *cornersOf{nullptr};
+
     };
 
   } // ::ospray::bilinearPatch
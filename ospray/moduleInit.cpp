@@ -17,6 +17,7 @@
 /*! \file ospray/moduleInit \brief Defines the module initialization callback */
 
 #include "geometry/Impi.h"
+#include "common/ImpiStats.h"
 
 /*! _everything_ in the ospray core universe should _always_ be in the
   'ospray' namespace. */
@@ -27,6 +28,9 @@ namespace ospray {
     {
       std::cout << "#osp: initializing the 'Implicit Iso-Surfaces Geometry (IMPI)' module"
 		<< std::endl;
+      // before anything is built, or frees of uncounted allocations
+      // would make the count go negative
+      installEmbreeMemoryMonitor();
     }
     
   } // ::ospray::bilinearPatch
@@ -34,9 +34,20 @@ namespace ospray {
                               int segment)
           : StructuredVolumeSource(volume), segVol(segVol), segment(segment)
         {}
+
+        SegmentedVolumeSource(std::shared_ptr<impi::structured::LogicalVolume> volume,
+                              std::shared_ptr<impi::structured::LogicalVolume> segVol,
+                              int segment,
+                              const vec3f &origin, const vec3f &spacing)
+          : StructuredVolumeSource(volume,origin,spacing), segVol(segVol), segment(segment)
+        {}
         
         /*! create lits of *all* voxel (refs) we want to be considered for interesction */
         virtual void   getActiveVoxels(std::vector<VoxelRef> &activeVoxels, float isoValue) const override;
+
+        /*! bytes held for the vertex values and the segment ids */
+        virtual size_t storageBytes() const override
+        { return StructuredVolumeSource::storageBytes() + segVol->storageBytes(); }
       
         std::shared_ptr<impi::structured::LogicalVolume> segVol;
         const int segment;
@@ -30,7 +30,7 @@ namespace ospray {
       box3fa StructuredVolumeSource::getVoxelBounds(const VoxelSource::VoxelRef voxelRef) const 
       {
         const vec3i idx = ((structured::VoxelRef &)voxelRef).asVec3i();
-        const vec3f lo = vec3f(idx)*scaleDims;
+        const vec3f lo = origin+vec3f(idx)*scaleDims;
         return box3fa(lo,lo+scaleDims);
       }
       
@@ -39,7 +39,7 @@ namespace ospray {
       {
         Impi::Voxel voxel;
         const vec3i idx = ((structured::VoxelRef &)voxelRef).asVec3i();
-        const vec3f lo = vec3f(idx)*scaleDims;
+        const vec3f lo = origin+vec3f(idx)*scaleDims;
         voxel.bounds = box3fa(lo,lo+scaleDims);
         volume->getVoxel((structured::Voxel &)voxel.vtx,idx);
         return voxel;
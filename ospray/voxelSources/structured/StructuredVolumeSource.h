@@ -30,7 +30,14 @@ namespace ospray {
       struct StructuredVolumeSource : public Impi::VoxelSource {
 
         StructuredVolumeSource(std::shared_ptr<impi::structured::LogicalVolume> volume)
-          : volume(volume), dims(volume->getDims()), scaleDims(rcp(vec3f(volume->getDims())-vec3f(1.f)))
+          : volume(volume), dims(volume->getDims()), origin(0.f), scaleDims(rcp(vec3f(volume->getDims())-vec3f(1.f)))
+        {}
+
+        /*! same, with the first vertex at 'origin' and 'spacing'
+          between vertices (ospray's gridOrigin and gridSpacing) */
+        StructuredVolumeSource(std::shared_ptr<impi::structured::LogicalVolume> volume,
+                               const vec3f &origin, const vec3f &spacing)
+          : volume(volume), dims(volume->getDims()), origin(origin), scaleDims(spacing)
         {}
         
         /*! create lits of *all* voxel (refs) we want to be considered for interesction */
@@ -41,9 +48,14 @@ namespace ospray {
       
         /*! get full voxel - bounds and vertex values - for given voxel */
         virtual Impi::Voxel  getVoxel(const VoxelRef voxelRef) const override;
+
+        /*! bytes held for the vertex values (not those of a view) */
+        virtual size_t storageBytes() const
+        { return volume->storageBytes(); }
       
         std::shared_ptr<impi::structured::LogicalVolume> volume;
         const vec3i dims;
+        const vec3f origin;
         const vec3f scaleDims;
       };
 
@@ -97,6 +97,16 @@ namespace ospray {
 
       template std::shared_ptr<LogicalVolume> VolumeT<float>::loadRAW(const std::string fileName,
                                                                       const vec3i &dims);
+
+      template<typename T>
+      std::shared_ptr<LogicalVolume> VolumeT<T>::wrap(T *values,
+                                                      const vec3i &dims)
+      {
+        return std::make_shared<VolumeT<T>>(dims,values);
+      }
+
+      template std::shared_ptr<LogicalVolume> VolumeT<float>::wrap(float *values,
+                                                                   const vec3i &dims);
     }    
   } // ::ospray::impi
 } // ::ospray
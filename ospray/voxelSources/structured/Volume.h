@@ -84,6 +84,9 @@ namespace ospray {
         /*! build list of all voxels that fulfill the given filter lambda */
         template<typename Lambda>
         void filterVoxels(std::vector<VoxelRef> &out, Lambda filter);
+
+        /*! bytes allocated for the values (zero if they are borrowed) */
+        virtual size_t storageBytes() const = 0;
       
         /*! create a list of *all* the voxel references in the entire volume
           whose value range overlaps the given iso-value */ 
@@ -100,12 +103,29 @@ namespace ospray {
 
         /*! constructor */
         VolumeT(const vec3i &dims) : array3D::ActualArray3D<T>(dims) {}
+
+        /*! a view of 'dims' values that the caller keeps alive */
+        VolumeT(const vec3i &dims, T *values)
+          : array3D::ActualArray3D<T>(dims,values), ownsValues(false)
+        {}
       
         /*! return dimensions (in voxels, not voxels!) of the underlying volume */
         virtual vec3i getDims() const override { return this->size(); }
 
         static std::shared_ptr<LogicalVolume> loadRAW(const std::string fileName,
                                                       const vec3i &dims);
+
+        /*! create a view of 'dims' values, see above */
+        static std::shared_ptr<LogicalVolume> wrap(T *values,
+                                                   const vec3i &dims);
+
+        virtual size_t storageBytes() const override
+        {
+          const vec3i dims = getDims();
+          return ownsValues ? size_t(dims.x)*dims.y*dims.z*sizeof(T) : 0;
+        }
+
+        const bool ownsValues{true};
       
       
         inline Range getRangeOfVoxel(const vec3i &voxelIdx) const
@@ -143,7 +163,8 @@ namespace ospray {
       {
         /*! for now, do this single-threaded: \todo use tasksys ... */
         out.clear();
-        array3D::for_each(getDims(),[&](const vec3i &idx) {
+        /* the last vertex in each dimension does not start a voxel */
+        array3D::for_each(getDims()-vec3i(1),[&](const vec3i &idx) {
             if (filter(this,idx))
               out.push_back(VoxelRef(idx));
           });
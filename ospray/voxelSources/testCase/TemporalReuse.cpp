@@ -0,0 +1,278 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#include "TemporalReuse.h"
+#include "ospcommon/tasking/parallel_for.h"
+#include "volume/amr/AMRAccel.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace ospray {
+  namespace impi {
+    namespace testCase {
+
+      /*! a copy of the bricks of one volume, shared by all keys */
+      struct BrickHistory
+      {
+        struct Brick
+        {
+          box3i box;
+          int level;
+          box3f worldBounds;
+          std::vector<float> values;
+        };
+        std::vector<Brick> bricks;
+      };
+
+      /*! what one timestep leaves for the next */
+      struct TemporalHistory
+      {
+        float isoValue;
+        std::string storage;
+        std::shared_ptr<const BrickHistory> bricks;
+        std::vector<TemporalReuse::Leaf> leaves;
+      };
+
+      /*! the histories by key, each is taken by the next timestep */
+      static std::mutex registryMutex;
+      static std::map<std::string, std::shared_ptr<TemporalHistory>> registry;
+
+      /*! the brick copies by volume, alive as long as a history holds
+          them. the volume is kept alive with them, so that its address
+          cannot be taken by the volume of a later timestep */
+      static std::mutex snapshotMutex;
+      static std::map<const AMRVolume *,
+                      std::pair<Ref<AMRVolume>, std::weak_ptr<BrickHistory>>>
+          snapshots;
+
+      /*! the copy of the bricks of 'amr', made by the first key that
+          asks for it */
+      static std::shared_ptr<const BrickHistory> snapshotOf(
+          const AMRVolume &amr)
+      {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        for (auto it = snapshots.begin(); it != snapshots.end();) {
+          if (it->second.second.expired())
+            it = snapshots.erase(it);
+          else
+            ++it;
+        }
+        auto found = snapshots.find(&amr);
+        if (found != snapshots.end())
+          return found->second.second.lock();
+
+        auto copy          = std::make_shared<BrickHistory>();
+        const auto &bricks = amr.data->brick;
+        copy->bricks.resize(bricks.size());
+        tasking::parallel_for(bricks.size(), [&](size_t bid) {
+          const auto &b = bricks[bid];
+          auto &h       = copy->bricks[bid];
+          h.box         = b.box;
+          h.level       = b.level;
+          h.worldBounds = b.worldBounds;
+          h.values.assign(b.value, b.value + b.dims.product());
+        });
+        snapshots[&amr] = std::make_pair(
+            Ref<AMRVolume>(const_cast<AMRVolume *>(&amr)),
+            std::weak_ptr<BrickHistory>(copy));
+        return copy;
+      }
+
+      /*! the largest 'delta' of the boxes touching a query box, boxes
+          are binned into a uniform grid over the world bounds */
+      class DeltaGrid
+      {
+       public:
+        DeltaGrid(const box3f &world, size_t numBoxes) : world(world)
+        {
+          const int n = std::max(1, std::min(64, int(std::cbrt(numBoxes))));
+          dims        = vec3i(n);
+          scale       = vec3f(dims) / max(world.size(), vec3f(1e-20f));
+          cells.resize(size_t(n) * n * n);
+        }
+
+        void insert(const box3f &box, const float delta)
+        {
+          const vec3i lo = cellOf(box.lower), hi = cellOf(box.upper);
+          for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+              for (int x = lo.x; x <= hi.x; ++x)
+                cells[(size_t(z) * dims.y + y) * dims.x + x].emplace_back(
+                    box, delta);
+        }
+
+        float query(const box3f &box) const
+        {
+          float delta     = 0.f;
+          const vec3i lo = cellOf(box.lower), hi = cellOf(box.upper);
+          for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+              for (int x = lo.x; x <= hi.x; ++x)
+                for (const auto &e :
+                     cells[(size_t(z) * dims.y + y) * dims.x + x]) {
+                  if (e.second > delta && touchingOrOverlapping(e.first, box))
+                    delta = e.second;
+                }
+          return delta;
+        }
+
+       private:
+        vec3i cellOf(const vec3f &p) const
+        {
+          const vec3f c = (p - world.lower) * scale;
+          const vec3i i(int(std::floor(c.x)),
+                        int(std::floor(c.y)),
+                        int(std::floor(c.z)));
+          return max(vec3i(0), min(i, dims - vec3i(1)));
+        }
+
+        box3f world;
+        vec3i dims;
+        vec3f scale;
+        std::vector<std::vector<std::pair<box3f, float>>> cells;
+      };
+
+      TemporalReuse::TemporalReuse(const std::string &key,
+                                   const AMRVolume &amr,
+                                   float isoValue,
+                                   const std::string &storage)
+          : key(key), next(std::make_shared<TemporalHistory>())
+      {
+        std::shared_ptr<TemporalHistory> previous;
+        {
+          std::lock_guard<std::mutex> lock(registryMutex);
+          auto it = registry.find(key);
+          if (it != registry.end()) {
+            previous = it->second;
+            registry.erase(it);
+          }
+        }
+
+        // keep this timestep for the next one
+        const auto &bricks = amr.data->brick;
+        const auto &leaves = amr.accel->leaf;
+        next->isoValue     = isoValue;
+        next->storage      = storage;
+        next->bricks       = snapshotOf(amr);
+        next->leaves.resize(leaves.size());
+        reuse.resize(leaves.size());
+        for (size_t lid = 0; lid < leaves.size(); ++lid)
+          next->leaves[lid].bounds = leaves[lid].bounds;
+
+        if (!previous || previous->isoValue != isoValue ||
+            previous->storage != storage) {
+          printf("#osp:impi: temporal reuse '%s': no previous timestep\n",
+                 key.c_str());
+          return;
+        }
+
+        // bricks with the same box and level, and how far their values
+        // moved (infinitely for new ones)
+        const float inf = std::numeric_limits<float>::infinity();
+        const auto &previousBricks = previous->bricks->bricks;
+        std::map<std::array<int, 7>, size_t> previousBrick;
+        for (size_t i = 0; i < previousBricks.size(); ++i) {
+          const auto &p = previousBricks[i];
+          previousBrick[{p.level,
+                         p.box.lower.x, p.box.lower.y, p.box.lower.z,
+                         p.box.upper.x, p.box.upper.y, p.box.upper.z}] = i;
+        }
+        std::vector<long> match(bricks.size(), -1);
+        std::vector<bool> matched(previousBricks.size(), false);
+        for (size_t bid = 0; bid < bricks.size(); ++bid) {
+          const auto &b = bricks[bid];
+          auto it       = previousBrick.find({b.level,
+                                        b.box.lower.x, b.box.lower.y,
+                                        b.box.lower.z, b.box.upper.x,
+                                        b.box.upper.y, b.box.upper.z});
+          if (it != previousBrick.end()) {
+            match[bid]          = it->second;
+            matched[it->second] = true;
+          }
+        }
+        std::vector<float> delta(bricks.size(), inf);
+        tasking::parallel_for(bricks.size(), [&](size_t bid) {
+          if (match[bid] < 0)
+            return;
+          const auto &cur  = next->bricks->bricks[bid].values;
+          const auto &prev = previousBricks[match[bid]].values;
+          float d = 0.f;
+          for (size_t i = 0; i < cur.size(); ++i)
+            d = std::max(d, std::abs(cur[i] - prev[i]));
+          delta[bid] = d;
+        });
+
+        // changed, new and removed bricks, and how far a leaf reaches:
+        // the octants on its faces sample cells of the coarsest level
+        DeltaGrid grid(amr.accel->worldBounds, bricks.size());
+        float reach = 0.f;
+        for (size_t bid = 0; bid < bricks.size(); ++bid) {
+          reach = std::max(reach, bricks[bid].cellWidth);
+          if (delta[bid] > 0.f)
+            grid.insert(bricks[bid].worldBounds, delta[bid]);
+        }
+        for (size_t i = 0; i < previousBricks.size(); ++i) {
+          if (!matched[i])
+            grid.insert(previousBricks[i].worldBounds, inf);
+        }
+
+        // leaves with the same bounds whose margin 'delta' stays below
+        std::map<std::array<float, 6>, size_t> previousLeaf;
+        for (size_t i = 0; i < previous->leaves.size(); ++i) {
+          const auto &b = previous->leaves[i].bounds;
+          previousLeaf[{b.lower.x, b.lower.y, b.lower.z,
+                        b.upper.x, b.upper.y, b.upper.z}] = i;
+        }
+        size_t numReusable = 0;
+        for (size_t lid = 0; lid < leaves.size(); ++lid) {
+          const auto &b = leaves[lid].bounds;
+          auto it       = previousLeaf.find({b.lower.x, b.lower.y, b.lower.z,
+                                       b.upper.x, b.upper.y, b.upper.z});
+          if (it == previousLeaf.end())
+            continue;
+          auto &prev    = previous->leaves[it->second];
+          const float d = grid.query(
+              box3f(b.lower - vec3f(reach), b.upper + vec3f(reach)));
+          if (d < prev.margin) {
+            reuse[lid].reset(new Leaf(std::move(prev)));
+            reuse[lid]->margin -= d;
+            ++numReusable;
+          }
+        }
+        printf("#osp:impi: temporal reuse '%s': %zu of %zu leaves unchanged\n",
+               key.c_str(),
+               numReusable,
+               leaves.size());
+      }
+
+      TemporalReuse::~TemporalReuse() {}
+
+      const TemporalReuse::Leaf *TemporalReuse::reusable(size_t lid) const
+      {
+        return reuse[lid].get();
+      }
+
+      void TemporalReuse::record(size_t lid,
+                                 float margin,
+                                 std::vector<uint32_t> oids)
+      {
+        auto &leaf  = next->leaves[lid];
+        leaf.margin = margin;
+        leaf.oids   = std::move(oids);
+      }
+
+      void TemporalReuse::store()
+      {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry[key] = next;
+        next.reset();
+      }
+
+    }  // namespace testCase
+  }    // namespace impi
+}  // namespace ospray
@@ -0,0 +1,82 @@
+// ======================================================================== //
+// Copyright SCI Institute, University of Utah, 2018
+// ======================================================================== //
+
+#pragma once
+
+/*! \file TemporalReuse.h Reuse of the active octants of the previous
+  timestep, for AMR time series whose bricks barely change.
+
+  An impi geometry with a "temporalKey" leaves, under that key, a copy
+  of its bricks and the active octants of every AMR leaf. The geometry
+  of the next timestep with the same key then skips the extraction of
+  every leaf whose bricks (BrickInfo box and level) are unchanged and
+  whose values moved too little to change the active set: octant
+  vertex values are interpolated from the cells around them, so they
+  move at most as far as the largest change 'delta' of a cell within
+  reach, and a voxel can only change state if the iso-value is closer
+  than that to one of its vertex values. Each leaf records how close
+  that is for its voxels (its 'margin'); a leaf is reused if 'delta'
+  stays below it, and the margin shrinks by 'delta' for the next
+  timestep. Reused leaves only recompute the vertex values of their
+  active octants.
+
+  This costs a copy of all brick values per volume, shared by all keys
+  of that volume (and two while the next timestep is compared), and is
+  skipped when extraction is split across mpi workers or ranks. */
+
+#include "volume/amr/AMRVolume.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace impi {
+    namespace testCase {
+
+      struct TemporalHistory;
+
+      class TemporalReuse
+      {
+       public:
+        /*! what a leaf extracted: its active octants (the 'oid' of
+            getOneVoxel_octant) and how close the iso-value came to
+            changing the state of one of its voxels */
+        struct Leaf
+        {
+          box3f bounds;
+          float margin{0.f};
+          std::vector<uint32_t> oids;
+        };
+
+        /*! compare 'amr' to what was stored under 'key' for the same
+            iso-value and storage strategy */
+        TemporalReuse(const std::string &key,
+                      const AMRVolume &amr,
+                      float isoValue,
+                      const std::string &storage);
+        ~TemporalReuse();
+
+        /*! what leaf 'lid' extracted in the previous timestep, with the
+            margin already shrunk by this timestep's change, or nullptr
+            if it has to be extracted again */
+        const Leaf *reusable(size_t lid) const;
+
+        /*! what leaf 'lid' extracted this time (thread safe for
+            different leaves) */
+        void record(size_t lid, float margin, std::vector<uint32_t> oids);
+
+        /*! keep what was recorded for the next timestep */
+        void store();
+
+       private:
+        const std::string key;
+        std::shared_ptr<TemporalHistory> next;
+        /*! per leaf the previous one, with its margin shrunk */
+        std::vector<std::unique_ptr<Leaf>> reuse;
+      };
+
+    }  // namespace testCase
+  }    // namespace impi
+}  // namespace ospray
@@ -19,8 +19,13 @@
 #include "compute_voxels_ispc.h"
 #include "ospcommon/tasking/parallel_for.h"
 #include "ospcommon/utility/getEnvVar.h"
+#include "../../common/ImpiMPI.h"
+#include "../../common/ImpiStats.h"
+#include "../../common/ImpiTrace.h"
+#include "TemporalReuse.h"
 
 #include <time.h>
+#include <atomic>
 #include <numeric>
 
 
@@ -34,6 +39,73 @@
 
 typedef ospray::amr::AMRAccel::Leaf AMRLeaf;
 
+namespace ospray {
+  namespace impi {
+    namespace testCase {
+
+      /*! number of octants the extraction visits in a leaf (see
+          getAllVoxels_*), which is what its cost is proportional to */
+      static size_t numLeafOctants(const AMRLeaf &lf)
+      {
+        const float s   = lf.brickList[0]->gridToWorldScale;
+        const size_t nx = std::round((lf.bounds.upper.x - lf.bounds.lower.x) * s);
+        const size_t ny = std::round((lf.bounds.upper.y - lf.bounds.lower.y) * s);
+        const size_t nz = std::round((lf.bounds.upper.z - lf.bounds.lower.z) * s);
+        return (nx - size_t(1)) * (ny - size_t(1)) * (nz - size_t(1)) +
+               size_t(8) * (ny * nx + nz * ny + nz * nx);
+      }
+
+      /*! the leaves [begin,end) this worker extracts, see ImpiMPI.h */
+      static void partitionLeaves(const ospray::amr::AMRAccel &accel,
+                                  const bool dataParallel,
+                                  size_t &begin, size_t &end)
+      {
+        // the workers of a data-parallel run hold different leaves
+        if (dataParallel) {
+          begin = 0;
+          end   = accel.leaf.size();
+          return;
+        }
+        std::vector<size_t> weights(accel.leaf.size());
+        for (size_t lid = 0; lid < weights.size(); ++lid)
+          weights[lid] = numLeafOctants(accel.leaf[lid]);
+        mpi::partition(weights, begin, end);
+        if (mpi::enabled())
+          printf("#osp:impi: worker %d/%d extracts leaves [%zu,%zu) of %zu\n",
+                 mpi::rank(), mpi::size(), begin, end, weights.size());
+      }
+
+      /*! what the extraction of one leaf stages for storage "active":
+          the active voxels and their octant ids */
+      struct ActiveLeaf
+      {
+        std::vector<Voxel> voxels;
+        std::vector<uint32_t> oids;
+      };
+
+      /*! the temporal reuse of a geometry with a "temporalKey", nullptr
+          without or if the leaves are split across workers or ranks */
+      static std::unique_ptr<TemporalReuse> beginTemporalReuse(
+          const std::string &key,
+          const AMRVolume &amr,
+          const bool dataParallel,
+          const float isoValue,
+          const std::string &storage)
+      {
+        if (key.empty())
+          return nullptr;
+        if (dataParallel || mpi::enabled()) {
+          printf("#osp:impi: no temporal reuse with split extraction\n");
+          return nullptr;
+        }
+        return std::unique_ptr<TemporalReuse>(
+            new TemporalReuse(key, amr, isoValue, storage));
+      }
+
+    }  // namespace testCase
+  }    // namespace impi
+}  // namespace ospray
+
 namespace ospray {
   namespace impi {
     namespace testCase {
@@ -42,13 +114,23 @@ namespace ospray {
       // Main Functions
       // ================================================================== //
       /*! constructors and distroctors */
-      TestOctant::TestOctant(AMRVolume *amr, float isoValue)
+      TestOctant::TestOctant(AMRVolume *amr,
+                             float isoValue,
+                             const std::string &storage,
+                             const std::vector<box3fa> &clip,
+                             const std::string &temporalKey)
           : reconMethod(
                 ospcommon::utility::getEnvVar<std::string>("IMPI_AMR_METHOD")
                     .value_or("octant")),
             storeMethod(
-                ospcommon::utility::getEnvVar<std::string>("IMPI_AMR_STORAGE")
-                    .value_or("active")),
+                !storage.empty()
+                    ? storage
+                    : ospcommon::utility::getEnvVar<std::string>(
+                          "IMPI_AMR_STORAGE")
+                          .value_or("active")),
+            clipBoxes(clip),
+            dataParallel(!clip.empty()),
+            temporalKey(temporalKey),
             amrVolumePtr(amr)
       {
         /* debug */
@@ -64,9 +146,9 @@ namespace ospray {
                   << amr->accel->leaf.size() << std::endl;
 
         /* compute default bbox */
-        // TODO: we should use getParamData here to set bounding boxes
-        clipBoxes.push_back(box3fa(amr->accel->worldBounds.lower,
-                                   amr->accel->worldBounds.upper));
+        if (clipBoxes.empty())
+          clipBoxes.push_back(box3fa(amr->accel->worldBounds.lower,
+                                     amr->accel->worldBounds.upper));
       }
       TestOctant::~TestOctant() {}
 
@@ -118,6 +200,40 @@ namespace ospray {
         }
       }
 
+      void TestOctant::getCorners(const ospray::AMRVolume *attribute,
+                                  const std::vector<VoxelRef> &refs,
+                                  std::vector<float> &corners,
+                                  std::vector<vec4f> &bounds) const
+      {
+        trace::Scope scope("TestOctant::getCorners");
+        if (attribute->accel->leaf.size() != amrVolumePtr->accel->leaf.size())
+          throw std::runtime_error("#osp:impi: the attribute volume has "
+                                   "other bricks than the iso-value one");
+        corners.resize(refs.size() * 8);
+        bounds.resize(refs.size());
+        const size_t blockSize = 1024;
+        const size_t numBlocks = (refs.size() + blockSize - 1) / blockSize;
+        tasking::parallel_for(numBlocks, [&](size_t blockID) {
+          const size_t b = blockID * blockSize;
+          const size_t n = std::min(blockSize, refs.size() - b);
+          std::vector<vec3f> lower(n);
+          std::vector<float> width(n);
+          for (size_t i = 0; i < n; ++i) {
+            const box3fa box = getVoxelBounds(refs[b + i]);
+            lower[i]         = vec3f(box.lower);
+            width[i]         = box.upper.x - box.lower.x;
+            bounds[b + i]    = vec4f(lower[i], width[i]);
+          }
+          // extraction always reconstructs octant vertices with
+          // AMR_octant, whatever IMPI_AMR_METHOD says
+          ispc::getAMRValue_Octant(attribute->getIE(),
+                                   &corners[b * 8],
+                                   (ispc::vec3f *)lower.data(),
+                                   width.data(),
+                                   (int)n);
+        });
+      }
+
       /*! preprocess voxel list base on method */
       void TestOctant::build(float isoValue)
       {
@@ -147,6 +263,7 @@ namespace ospray {
       // ================================================================== //
       extern "C" void externC_push_back_active(void *_c_vector,
                                                void *_c_ptr,
+                                               const uint32_t oid,
                                                const float v0,
                                                const float v1,
                                                const float v2,
@@ -164,7 +281,8 @@ namespace ospray {
         const vec3f coordinate(c0, c1, c2);
         const box3fa box(coordinate, coordinate + cellwidth);
         if (c_ptr->inClipBox(box)) {
-          auto c_vector = (std::vector<Voxel> *)_c_vector;
+          auto c_leaf   = (ActiveLeaf *)_c_vector;
+          auto c_vector = &c_leaf->voxels;
           c_vector->emplace_back();
           c_vector->back().vtx[0][0][0] = v0;
           c_vector->back().vtx[0][0][1] = v1;
@@ -175,6 +293,7 @@ namespace ospray {
           c_vector->back().vtx[1][1][0] = v6;
           c_vector->back().vtx[1][1][1] = v7;
           c_vector->back().bounds       = box;
+          c_leaf->oids.push_back(oid);
         }
       }
 
@@ -192,6 +311,7 @@ namespace ospray {
       /*! preprocess voxel list base on method */
       void TestOctant::build_active(float isoValue)
       {
+        trace::Scope scope("TestOctant::build_active");
         voxels.clear();
         //
         // initialization
@@ -201,10 +321,34 @@ namespace ospray {
         //
         // Testing my implementation
         //
-        auto leafActiveOctants = new std::vector<Voxel>[nLeaf];
+        auto leafActiveOctants = new ActiveLeaf[nLeaf];
+        size_t leafBegin, leafEnd;
+        partitionLeaves(*accel, dataParallel, leafBegin, leafEnd);
+        auto reuse = beginTemporalReuse(temporalKey, *amrVolumePtr,
+                                        dataParallel, isoValue, storeMethod);
+        std::atomic<size_t> numReused(0);
+        beginProgress(leafEnd - leafBegin);
         speedtest__("#osp:impi: Preprocessing Voxel Values")
         {
-          tasking::parallel_for(nLeaf, [&](size_t lid) {
+          tasking::parallel_for(leafEnd - leafBegin, [&](size_t i) {
+            const size_t lid = leafBegin + i;
+            trace::Scope leaf("leaf", "impi.leaf", "leaf", lid);
+            //
+            // unchanged since the previous timestep: the same octants
+            // are active, only their values are recomputed
+            //
+            if (const auto *prev = reuse ? reuse->reusable(lid) : nullptr) {
+              auto &out = leafActiveOctants[lid];
+              out.oids  = prev->oids;
+              out.voxels.reserve(out.oids.size());
+              for (const uint32_t oid : out.oids)
+                out.voxels.push_back(
+                    getVoxel_none((uint64_t(lid) << 32) | uint64_t(oid)));
+              reuse->record(lid, prev->margin, out.oids);
+              ++numReused;
+              advanceProgress();
+              return;
+            }
             //
             // meta data
             //
@@ -237,6 +381,7 @@ namespace ospray {
             //
             const size_t b = 0;
             const size_t e = N;
+            float margin;
             ispc::getAllVoxels_active(amrVolumePtr->getIE(),
                                       this,
                                       &leafActiveOctants[lid],
@@ -251,25 +396,41 @@ namespace ospray {
                                       (uint32_t)nz,
                                       (uint32_t)n1,
                                       (uint32_t)(n2 + n1),
-                                      (uint32_t)(n3 + n2 + n1));
+                                      (uint32_t)(n3 + n2 + n1),
+                                      margin);
+            if (reuse)
+              reuse->record(lid, margin, leafActiveOctants[lid].oids);
+            advanceProgress();
           });
         }
+        endProgress();
+        numLeaves    = leafEnd - leafBegin;
+        reusedLeaves = numReused;
+        if (reuse)
+          reuse->store();
         std::cout << "#osp:impi: Done Computing Values Values" << std::endl;
 
         std::vector<size_t> begin(nLeaf, size_t(0));
         size_t n(0);
+        trace::Scope gather("TestOctant::build_active gather");
+        stagingPeakBytes = 0;
         for (int lid = 0; lid < nLeaf; ++lid) {
           begin[lid] = n;
-          n += leafActiveOctants[lid].size();
+          n += leafActiveOctants[lid].voxels.size();
+          stagingPeakBytes +=
+              leafActiveOctants[lid].voxels.capacity() * sizeof(Voxel) +
+              leafActiveOctants[lid].oids.capacity() * sizeof(uint32_t);
         }
         voxels.resize(n);
         tasking::parallel_for(nLeaf, [&](const size_t lid) {
-          std::copy(leafActiveOctants[lid].begin(),
-                    leafActiveOctants[lid].end(),
+          std::copy(leafActiveOctants[lid].voxels.begin(),
+                    leafActiveOctants[lid].voxels.end(),
                     &voxels[begin[lid]]);
         });
 
         delete[] leafActiveOctants;
+        if (!dataParallel)
+          mpi::allgather(voxels);
 
         std::cout << "Done Init Octant Value! " << voxels.size() << std::endl;
       }
@@ -278,6 +439,7 @@ namespace ospray {
       void TestOctant::getActiveVoxels_active(
           std::vector<VoxelRef> &activeVoxels, float isoValue) const
       {
+        trace::Scope scope("TestOctant::getActiveVoxels_active");
         activeVoxels.clear();  // the output
         for (int i = 0; i < voxels.size(); ++i) {
           activeVoxels.push_back(i);
@@ -418,15 +580,38 @@ namespace ospray {
       void TestOctant::getActiveVoxels_none(std::vector<VoxelRef> &activeVoxels,
                                             float isoValue) const
       {
+        trace::Scope scope("TestOctant::getActiveVoxels_none");
         //
         // Testing my implementation
         //
         const auto &accel      = amrVolumePtr->accel;
         const auto nLeaf       = accel->leaf.size();
         auto leafActiveOctants = new std::vector<uint64_t>[nLeaf];
+        size_t leafBegin, leafEnd;
+        partitionLeaves(*accel, dataParallel, leafBegin, leafEnd);
+        auto reuse = beginTemporalReuse(temporalKey, *amrVolumePtr,
+                                        dataParallel, isoValue, storeMethod);
+        std::atomic<size_t> numReused(0);
+        beginProgress(leafEnd - leafBegin);
         speedtest__("#osp:impi: Preprocess Voxel Values")
         {
-          tasking::parallel_for(nLeaf, [&](size_t lid) {
+          tasking::parallel_for(leafEnd - leafBegin, [&](size_t i) {
+            const size_t lid = leafBegin + i;
+            trace::Scope leaf("leaf", "impi.leaf", "leaf", lid);
+            //
+            // unchanged since the previous timestep: the same octants
+            // are active
+            //
+            if (const auto *prev = reuse ? reuse->reusable(lid) : nullptr) {
+              auto &out = leafActiveOctants[lid];
+              out.reserve(prev->oids.size());
+              for (const uint32_t oid : prev->oids)
+                out.push_back((uint64_t(lid) << 32) | uint64_t(oid));
+              reuse->record(lid, prev->margin, prev->oids);
+              ++numReused;
+              advanceProgress();
+              return;
+            }
             //
             // meta data
             //
@@ -470,6 +655,7 @@ namespace ospray {
             // const size_t e = std::min(b + blockSize, N);
             const size_t b = 0;
             const size_t e = N;
+            float margin;
             ispc::getAllVoxels_none(amrVolumePtr->getIE(),
                                     this,
                                     &leafActiveOctants[lid],
@@ -485,19 +671,37 @@ namespace ospray {
                                     (uint32_t)nz,
                                     (uint32_t)n1,
                                     (uint32_t)(n2 + n1),
-                                    (uint32_t)(n3 + n2 + n1));
+                                    (uint32_t)(n3 + n2 + n1),
+                                    margin);
             //});
+            if (reuse) {
+              std::vector<uint32_t> oids;
+              oids.reserve(leafActiveOctants[lid].size());
+              for (const uint64_t ref : leafActiveOctants[lid])
+                oids.push_back(uint32_t(ref));
+              reuse->record(lid, margin, std::move(oids));
+            }
+            advanceProgress();
           });
         }
+        endProgress();
+        numLeaves    = leafEnd - leafBegin;
+        reusedLeaves = numReused;
+        if (reuse)
+          reuse->store();
         //
         //
         //
         std::cout << "#osp:impi: Done Computing Values Values" << std::endl;
+        trace::Scope gather("TestOctant::getActiveVoxels_none gather");
         std::vector<size_t> begin(nLeaf, size_t(0));
         size_t n(0);
+        stagingPeakBytes = 0;
         for (int lid = 0; lid < nLeaf; ++lid) {
           begin[lid] = n;
           n += leafActiveOctants[lid].size();
+          stagingPeakBytes +=
+              leafActiveOctants[lid].capacity() * sizeof(uint64_t);
         }
         activeVoxels.resize(n);
         tasking::parallel_for(nLeaf, [&](const size_t lid) {
@@ -507,6 +711,8 @@ namespace ospray {
         });
 
         delete[] leafActiveOctants;
+        if (!dataParallel)
+          mpi::allgather(activeVoxels);
       }
     }  // namespace testCase
   }    // namespace impi
@@ -37,8 +37,18 @@ namespace ospray {
       struct TestOctant : public Impi::VoxelSource
       {
        public:
-        /*! constructors and distroctors */
-        TestOctant(ospray::AMRVolume *, float);
+        /*! constructors and distroctors, an empty storage strategy
+            falls back to the IMPI_AMR_STORAGE environment variable.
+            only voxels touching one of 'clipBoxes' are kept (default:
+            the whole volume); a data-parallel rank passes the region
+            it owns, its volume then only holds that region's bricks
+            and extraction is not split across workers (ImpiMPI.h).
+            a non-empty 'temporalKey' reuses what the previous source
+            with the same key extracted (TemporalReuse.h) */
+        TestOctant(ospray::AMRVolume *, float,
+                   const std::string &storage = "",
+                   const std::vector<box3fa> &clipBoxes = {},
+                   const std::string &temporalKey = "");
         virtual ~TestOctant();
 
         /*! get full voxel - bounds and vertex values - for given voxel */
@@ -54,6 +64,32 @@ namespace ospray {
         /*! preprocess voxel list base on method */
         void build(float isoValue);
 
+        /*! the values of 'attribute', an AMR volume with the same
+            bricks as ours (e.g. another component of the same file),
+            at the 8 corners of each of the voxels 'refs', reconstructed
+            like the extracted vertex values (octant method). 8 floats
+            per voxel, in the order of Voxel::vtx, and per voxel its
+            lower corner (xyz) and width (w) */
+        void getCorners(const ospray::AMRVolume *attribute,
+                        const std::vector<VoxelRef> &refs,
+                        std::vector<float> &corners,
+                        std::vector<vec4f> &bounds) const;
+
+        /*! bytes held by the voxel buffer (zero for storage "none") */
+        size_t storageBytes() const
+        {
+          return voxels.capacity() * sizeof(Voxel);
+        }
+
+        /*! bytes held by the per-leaf staging vectors of the last
+            extraction, measured when all of them were filled */
+        mutable size_t stagingPeakBytes{0};
+
+        /*! leaves of the last extraction, and how many of them reused
+            the previous timestep */
+        mutable size_t numLeaves{0};
+        mutable size_t reusedLeaves{0};
+
        private:
         /*! =============================================================== */
         /* void (*build_fcn)(float); */
@@ -112,10 +148,14 @@ namespace ospray {
           for different implementations */
         std::vector<Voxel> voxels;
 
-        std::vector<box3fa> clipBoxes;
-        const ospray::AMRVolume *amrVolumePtr;
+        /* declared in the order of the constructor's initializers */
         const std::string reconMethod; /* octant, current, nearest */
         const std::string storeMethod; /* all, active, none */
+        std::vector<box3fa> clipBoxes;
+        /*! true if the volume holds only a region of the data */
+        const bool dataParallel;
+        const std::string temporalKey;
+        const ospray::AMRVolume *amrVolumePtr;
 
        public:
         /*! initialization */